@@ -0,0 +1,353 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*every block handed out by an arena starts on this boundary (in bytes)*/
+#define ARENA_ALIGNMENT 16
+
+/*a bump allocator for the temporaries of one query.
+allocating moves a pointer forward and nothing is freed one by one, the whole arena
+is reset once the last user has left or given back down to a mark() by rewind().
+memory which did not fit is kept aside and folded into one larger block at the reset,
+so after the first few queries a query takes no memory from the heap at all.*/
+class Arena
+{
+private:
+
+	char *memory;
+	size_t size, used;
+
+	/*the blocks which did not fit into memory. every block starts with
+	a pointer to the block before it and its size, overflow_size is their total size*/
+	char *overflow;
+	size_t overflow_size;
+
+	size_t peak;//the most the arena has held at once since the reset, main block and overflow together
+
+	int users;//the number of enter() calls not yet matched by leave()
+
+	/*counts the blocks taken from the heap by all arenas and,
+	if BAYES_COUNT_ALLOCATIONS is defined, every other heap allocation too.
+	atomic, as the workers of a ThreadPool allocate as well*/
+	static atomic<unsigned long> allocations;
+
+	static Arena standalone;//see shared()
+
+	static char * take(size_t size);
+
+public:
+
+	Arena();
+
+	Arena(size_t size);
+
+	void * allocate(size_t bytes);
+
+	template <class T>
+	T * allocate(int n);
+
+	void enter();
+
+	void leave();
+
+	size_t mark();
+
+	void rewind(size_t mark);
+
+	void reset();
+
+	size_t getSize();
+
+	size_t getUsed();
+
+	static Arena & shared();
+
+	static void countAllocation();
+
+	static unsigned long getAllocations();
+
+	~Arena();
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*static variable initialization*/
+atomic<unsigned long> Arena::allocations(0);
+
+Arena Arena::standalone;
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+creates an empty arena, its first block is taken on the first allocation
+*/
+Arena::Arena() : Arena(0)
+{
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+Arena class constructor
+
+@param	size	the number of bytes reserved up front
+*/
+Arena::Arena(size_t size)
+{
+	this->size = size;
+	used = overflow_size = peak = 0;
+	users = 0;
+	overflow = NULL;
+	memory = size ? take(size) : NULL;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+takes a block from the heap and counts it
+
+@param	size	the number of bytes
+@return			the block
+*/
+char * Arena::take(size_t size)
+{
+	char *block = (char *)malloc(size);
+	if (!block)
+		throw bad_alloc();
+
+	countAllocation();
+	return block;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	bytes	the number of bytes required
+@return			a block of at least that many bytes, valid until the arena is reset
+*/
+void * Arena::allocate(size_t bytes)
+{
+	bytes = (bytes + ARENA_ALIGNMENT - 1) & ~((size_t)ARENA_ALIGNMENT - 1);
+
+	if (!overflow && used + bytes <= size)
+	{
+		void *block = memory + used;
+		used += bytes;
+		return block;
+	}
+
+	/*does not fit : keep it aside until the next reset. once anything has overflowed
+	everything does, so that rewind() finds the blocks in the order they were taken*/
+	char *block = take(bytes + ARENA_ALIGNMENT);
+	*(char **)block = overflow;
+	*(size_t *)(block + sizeof(char *)) = bytes;
+	overflow = block;
+	overflow_size += bytes;
+	if (used + overflow_size > peak)
+		peak = used + overflow_size;
+	return block + ARENA_ALIGNMENT;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	n	the number of elements
+@return		room for n elements of type T. no constructor is run.
+*/
+template <class T>
+T * Arena::allocate(int n)
+{
+	return (T *)allocate(n * sizeof(T));
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+marks the start of a piece of work drawing from the arena
+*/
+void Arena::enter()
+{
+	users++;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+marks the end of a piece of work, the last one to leave resets the arena
+*/
+void Arena::leave()
+{
+	if (--users == 0)
+		reset();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the point rewind() comes back to
+*/
+size_t Arena::mark()
+{
+	return used + overflow_size;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+gives back everything allocated since a mark(), so that a large temporary can be
+taken in the middle of a query without the arena having to hold all of them at once
+
+@param	mark	a value returned by mark(), with nothing rewound past it since
+*/
+void Arena::rewind(size_t mark)
+{
+	while (overflow && used + overflow_size > mark)
+	{
+		char *previous = *(char **)overflow;
+		overflow_size -= *(size_t *)(overflow + sizeof(char *));
+		free(overflow);
+		overflow = previous;
+	}
+
+	if (used > mark)
+		used = mark;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+forgets every allocation. if anything overflowed, the arena grows
+so that the same work fits into a single block the next time.
+*/
+void Arena::reset()
+{
+	while (overflow)
+	{
+		char *previous = *(char **)overflow;
+		free(overflow);
+		overflow = previous;
+	}
+
+	if (peak > size)
+	{
+		free(memory);
+		size = 2 * peak;
+		memory = take(size);
+	}
+
+	used = overflow_size = peak = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of bytes in the main block
+*/
+size_t Arena::getSize()
+{
+	return size;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of bytes of the main block in use
+*/
+size_t Arena::getUsed()
+{
+	return used;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the arena of the vertices which are in no Graph (a Graph has an arena of its own,
+see Vertex::getArena()). it is made before main() runs, but as all of those vertices share
+it they may only be used from one thread.
+*/
+Arena & Arena::shared()
+{
+	return standalone;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+counts one heap allocation
+*/
+void Arena::countAllocation()
+{
+	allocations++;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of heap allocations counted so far. only the arenas' own blocks
+are counted unless BAYES_COUNT_ALLOCATIONS is defined, so a steady state can be checked by
+comparing the value before and after a query.
+*/
+unsigned long Arena::getAllocations()
+{
+	return allocations;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+Arena::~Arena()
+{
+	while (overflow)
+	{
+		char *previous = *(char **)overflow;
+		free(overflow);
+		overflow = previous;
+	}
+	free(memory);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*defining BAYES_COUNT_ALLOCATIONS before this header replaces the global operator new,
+so that every allocation of the program is counted by Arena::getAllocations().
+meant for tests, and like everything else here it may only be included in one file.*/
+#ifdef BAYES_COUNT_ALLOCATIONS
+
+void * operator new(size_t size)
+{
+	void *block = malloc(size ? size : 1);
+	if (!block)
+		throw bad_alloc();
+
+	Arena::countAllocation();
+	return block;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+void operator delete(void *block) throw()
+{
+	free(block);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*the sized form, which C++14 compilers call instead when they know the size*/
+void operator delete(void *block, size_t) throw()
+{
+	free(block);
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,990 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "model.h"
+#include "kernels.h"
+#include "engine.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*the scenario dimension of every array is padded to a multiple of this,
+so the kernels never have to deal with a partial vector*/
+#define BATCH_PADDING 16
+
+/*belief propagation for many independent sets of evidence at once over one compiled Model.
+every message keeps one value per scenario, with the scenario changing fastest :
+entry (state x, scenario s) of a message lives at message[x * stride + s].
+a propagation runs the same schedule as the Engine but every step works on whole rows
+of scenarios, so the SIMD lanes of the kernels run across scenarios and the CPTs are
+read once per sweep however many scenarios there are.*/
+class BatchEngine
+{
+private:
+
+	Model *model;
+
+	int scenarios, stride;//stride is scenarios rounded up to BATCH_PADDING
+
+	int *evidence;//evidence[v * stride + s] is the observed state of v in scenario s (zero-based), -1 if unobserved
+
+	/*the message arena, laid out like the one of the Model but stride times larger :
+	vertex v owns lambda, pi and belief at vertex_offsets[v],
+	edge e owns its pi message and then its lambda message at edge_offsets[e]*/
+	int *vertex_offsets;
+	int *edge_offsets;
+	float *messages;
+
+	/*room for ENGINE_MAX_PARENTS + 3 rows of scenarios*/
+	float *scratch;
+
+	/*the running product of sendPi(), one row of scenarios for each state of the widest vertex*/
+	float *prefix;
+
+	float * lambda(int v);
+
+	float * pi(int v);
+
+	float * belief(int v);
+
+	float * piMessage(int e);
+
+	float * lambdaMessage(int e);
+
+	void normalize(float *message, int states);
+
+	void updateLambda(int v);
+
+	void updatePi(int v);
+
+	void updateBelief(int v);
+
+	void sendLambda(int e);
+
+	void sendPi(int e);
+
+	void sendPi(int u, int back);
+
+	void updateNoisyPi(int v);
+
+	void sendNoisyLambda(int e);
+
+	void treeWeight(int c, int slot, float *weight);
+
+	void updateTreePi(int v);
+
+	void sendTreeLambda(int e);
+
+public:
+
+	BatchEngine(Model *model, int scenarios);
+
+	Model * getModel();
+
+	int getScenarios();
+
+	void initialize();
+
+	void observe(int scenario, int v, int state);
+
+	void retract(int scenario, int v);
+
+	void propagate();
+
+	float p(int scenario, int v, int state);
+
+	void posterior(int v, float *matrix);
+
+	~BatchEngine();
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+BatchEngine class constructor
+
+@param	model		the compiled model to run on. it is not copied and must outlive the engine.
+@param	scenarios	the number of independent sets of evidence
+*/
+BatchEngine::BatchEngine(Model *model, int scenarios)
+{
+	if (scenarios < 1)
+		throw - 1;
+
+	for (int v = model->getSize() - 1; v >= 0; v--)
+	{
+		if (model->getParents(v).getSize() > ENGINE_MAX_PARENTS)
+			throw - 7;
+	}
+
+	this->model = model;
+	this->scenarios = scenarios;
+	stride = (scenarios + BATCH_PADDING - 1) / BATCH_PADDING * BATCH_PADDING;
+
+	int num_of_vertices = model->getSize(), num_of_edges = model->countEdges();
+	vertex_offsets = new int[num_of_vertices + 1];
+	edge_offsets = new int[num_of_edges + 1];
+
+	int widest = 1;
+	vertex_offsets[0] = 0;
+	for (int v = 0; v < num_of_vertices; v++)
+	{
+		vertex_offsets[v + 1] = vertex_offsets[v] + 3 * model->getCardinality(v) * stride;
+		widest = model->getCardinality(v) > widest ? model->getCardinality(v) : widest;
+	}
+
+	edge_offsets[0] = vertex_offsets[num_of_vertices];
+	for (int e = 0; e < num_of_edges; e++)
+	{
+		edge_offsets[e + 1] = edge_offsets[e] + 2 * model->getCardinality(model->getEdgeParent(e)) * stride;
+	}
+
+	messages = new float[edge_offsets[num_of_edges] + 1];
+	scratch = new float[(ENGINE_MAX_PARENTS + 3) * stride];
+	prefix = new float[widest * stride];
+	evidence = new int[num_of_vertices * stride + 1];
+
+	initialize();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the model the engine runs on
+*/
+Model * BatchEngine::getModel()
+{
+	return model;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of scenarios
+*/
+int BatchEngine::getScenarios()
+{
+	return scenarios;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+removes the evidence of every scenario and computes the prior probabilities
+*/
+void BatchEngine::initialize()
+{
+	for (int i = model->getSize() * stride - 1; i >= 0; i--)
+	{
+		evidence[i] = -1;
+	}
+	for (int i = edge_offsets[model->countEdges()] - 1; i >= 0; i--)
+	{
+		messages[i] = 1;
+	}
+	propagate();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+sets the state of a vertex as observed in one scenario. call propagate() afterwards.
+
+@param	scenario	the zero-based index of the scenario
+@param	v			the dense index of the vertex
+@param	state		the one-based index of the observed state
+*/
+void BatchEngine::observe(int scenario, int v, int state)
+{
+	if (scenario < 0 || scenario >= scenarios || v < 0 || v >= model->getSize() || state < 1 || state > model->getCardinality(v))
+		throw - 1;
+
+	evidence[v * stride + scenario] = state - 1;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+removes the observation of a vertex in one scenario. call propagate() afterwards.
+
+@param	scenario	the zero-based index of the scenario
+@param	v			the dense index of the vertex
+*/
+void BatchEngine::retract(int scenario, int v)
+{
+	if (scenario < 0 || scenario >= scenarios || v < 0 || v >= model->getSize())
+		throw - 1;
+
+	evidence[v * stride + scenario] = -1;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+recomputes every message and every posterior probability of every scenario.
+same two sweeps as Engine::propagate()
+*/
+void BatchEngine::propagate()
+{
+	View<int> schedule = model->getSchedule();
+
+	for (int i = schedule.getSize() - 1; i >= 0; i--)
+	{
+		int v = schedule[i], e = model->getPredecessorEdge(v);
+		if (e < 0)
+			continue;
+
+		if (model->getEdgeChild(e) == v)
+		{
+			updateLambda(v);
+			sendLambda(e);
+		}
+		else
+		{
+			updatePi(v);
+			sendPi(e);
+		}
+	}
+
+	for (int i = 0; i < schedule.getSize(); i++)
+	{
+		int v = schedule[i], back = model->getPredecessorEdge(v);
+
+		updateLambda(v);
+		updatePi(v);
+		updateBelief(v);
+
+		for (int e = model->getFirstEdge(v), k = 0; k < model->getParents(v).getSize(); e++, k++)
+		{
+			if (e != back)
+				sendLambda(e);
+		}
+
+		sendPi(v, back);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	the dense index of the vertex
+@return		its lambda evidence, states x stride
+*/
+float * BatchEngine::lambda(int v)
+{
+	return messages + vertex_offsets[v];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	the dense index of the vertex
+@return		its pi evidence, states x stride
+*/
+float * BatchEngine::pi(int v)
+{
+	return messages + vertex_offsets[v] + model->getCardinality(v) * stride;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	the dense index of the vertex
+@return		its posterior probabilities, states x stride
+*/
+float * BatchEngine::belief(int v)
+{
+	return messages + vertex_offsets[v] + 2 * model->getCardinality(v) * stride;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	e	the edge id
+@return		the message from the parent of the edge to its child
+*/
+float * BatchEngine::piMessage(int e)
+{
+	return messages + edge_offsets[e];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	e	the edge id
+@return		the message from the child of the edge to its parent
+*/
+float * BatchEngine::lambdaMessage(int e)
+{
+	return messages + edge_offsets[e] + model->getCardinality(model->getEdgeParent(e)) * stride;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+scales every scenario of a message so that it sums to 1.
+a scenario which sums to 0 (impossible evidence) is left at 0.
+
+@param	message		states x stride values
+@param	states		the number of states
+*/
+void BatchEngine::normalize(float *message, int states)
+{
+	float *sum = scratch + (ENGINE_MAX_PARENTS + 2) * stride;
+
+	Kernel::scale(sum, message, 1.0f, stride);
+	for (int x = 1; x < states; x++)
+	{
+		Kernel::add(sum, message + x * stride, stride);
+	}
+
+	for (int s = 0; s < stride; s++)
+	{
+		sum[s] = sum[s] > 0 ? 1.0f / sum[s] : 0.0f;
+	}
+
+	for (int x = 0; x < states; x++)
+	{
+		Kernel::multiply(message + x * stride, sum, stride);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+lambda(x) = evidence(x) * product of the lambda messages from all the children
+
+@param	v	the dense index of the vertex
+*/
+void BatchEngine::updateLambda(int v)
+{
+	int states = model->getCardinality(v);
+	float *lambda = this->lambda(v);
+	int *observed = evidence + v * stride;
+
+	for (int x = 0; x < states; x++)
+	{
+		for (int s = 0; s < stride; s++)
+		{
+			lambda[x * stride + s] = (observed[s] < 0 || observed[s] == x) ? 1.0f : 0.0f;
+		}
+	}
+
+	View<int> edges = model->getChildEdges(v);
+	for (int j = 0; j < edges.getSize(); j++)
+	{
+		Kernel::multiply(lambda, lambdaMessage(edges[j]), states * stride);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+pi(x) = sum over all parent combinations u of P(x | u) * product of pi messages(u_k)
+
+the rows of the CPT are walked in order. weights + k * stride holds the product of the
+messages of the first k parents for the current combination, so when a digit changes
+only the products from that parent on are rebuilt. only the non-zero entries of a sparse
+CPT are read, a noisy-MAX CPT goes to updateNoisyPi() and a tree one to updateTreePi().
+
+@param	v	the dense index of the vertex
+*/
+void BatchEngine::updatePi(int v)
+{
+	if (model->getKind(v) == MODEL_NOISY_MAX)
+	{
+		updateNoisyPi(v);
+		return;
+	}
+	if (model->getKind(v) == MODEL_TREE)
+	{
+		updateTreePi(v);
+		return;
+	}
+
+	View<int> parents = model->getParents(v);
+	int first = model->getFirstEdge(v), num_of_parents = parents.getSize(), states = model->getCardinality(v);
+	float *pi = this->pi(v), *table = model->getCPT(v), *weights = scratch;
+	SparseTable<float> sparse = model->getSparse(v);
+	bool dense = model->getKind(v) == MODEL_DENSE;
+
+	int digits[ENGINE_MAX_PARENTS] = { 0 };
+
+	for (int i = states * stride - 1; i >= 0; i--)
+	{
+		pi[i] = 0;
+	}
+	for (int s = 0; s < stride; s++)
+	{
+		weights[s] = 1;
+	}
+
+	for (int k = 0;;)
+	{
+		for (; k < num_of_parents; k++)
+		{
+			Kernel::multiply(weights + (k + 1) * stride, weights + k * stride, piMessage(first + k) + digits[k] * stride, stride);
+		}
+
+		float *weight = weights + num_of_parents * stride;
+		if (dense)
+		{
+			for (int x = 0; x < states; x++)
+			{
+				Kernel::axpy(pi + x * stride, table[x], weight, stride);
+			}
+			table += states;
+		}
+		else if (!sparse.rows)
+			Kernel::add(pi + *sparse.states++ * stride, weight, stride);
+		else
+		{
+			for (int j = sparse.rows[0]; j < sparse.rows[1]; j++)
+			{
+				Kernel::axpy(pi + sparse.states[j] * stride, sparse.values[j], weight, stride);
+			}
+			sparse.rows++;
+		}
+
+		k = num_of_parents - 1;
+		while (k >= 0 && ++digits[k] == model->getCardinality(parents[k]))
+		{
+			digits[k--] = 0;
+		}
+		if (k < 0)
+			break;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+belief(x) = alpha * lambda(x) * pi(x)
+
+@param	v	the dense index of the vertex
+*/
+void BatchEngine::updateBelief(int v)
+{
+	int states = model->getCardinality(v);
+
+	Kernel::multiply(belief(v), lambda(v), pi(v), states * stride);
+	normalize(belief(v), states);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the message from the child of an edge to its parent :
+message(u) = sum over the child's states x and the other parents' states w of
+lambda(x) * P(x | u, w) * product of the other pi messages(w_k)
+
+the rows of the CPT are walked like in updatePi(), with the parent the
+message goes to left out of the weights. a noisy-MAX CPT goes to sendNoisyLambda()
+and a tree one to sendTreeLambda().
+
+@param	e	the edge id
+*/
+void BatchEngine::sendLambda(int e)
+{
+	if (model->getKind(model->getEdgeChild(e)) == MODEL_NOISY_MAX)
+	{
+		sendNoisyLambda(e);
+		return;
+	}
+	if (model->getKind(model->getEdgeChild(e)) == MODEL_TREE)
+	{
+		sendTreeLambda(e);
+		return;
+	}
+
+	int c = model->getEdgeChild(e), states = model->getCardinality(c);
+	View<int> parents = model->getParents(c);
+	int first = model->getFirstEdge(c), num_of_parents = parents.getSize(), slot = e - first;
+	float *lambda = this->lambda(c), *table = model->getCPT(c), *message = lambdaMessage(e);
+	float *weights = scratch, *dot = scratch + (ENGINE_MAX_PARENTS + 1) * stride;
+	SparseTable<float> sparse = model->getSparse(c);
+	bool dense = model->getKind(c) == MODEL_DENSE;
+
+	int digits[ENGINE_MAX_PARENTS] = { 0 };
+
+	for (int i = model->getCardinality(parents[slot]) * stride - 1; i >= 0; i--)
+	{
+		message[i] = 0;
+	}
+	for (int s = 0; s < stride; s++)
+	{
+		weights[s] = 1;
+	}
+
+	for (int k = 0;;)
+	{
+		for (; k < num_of_parents; k++)
+		{
+			if (k == slot)
+				Kernel::scale(weights + (k + 1) * stride, weights + k * stride, 1.0f, stride);
+			else
+				Kernel::multiply(weights + (k + 1) * stride, weights + k * stride, piMessage(first + k) + digits[k] * stride, stride);
+		}
+
+		if (dense)
+		{
+			Kernel::scale(dot, lambda, table[0], stride);
+			for (int x = 1; x < states; x++)
+			{
+				Kernel::axpy(dot, table[x], lambda + x * stride, stride);
+			}
+			table += states;
+			Kernel::multiplyAdd(message + digits[slot] * stride, weights + num_of_parents * stride, dot, stride);
+		}
+		else if (!sparse.rows)
+			Kernel::multiplyAdd(message + digits[slot] * stride, weights + num_of_parents * stride, lambda + *sparse.states++ * stride, stride);
+		else
+		{
+			Kernel::scale(dot, lambda, 0.0f, stride);
+			for (int j = sparse.rows[0]; j < sparse.rows[1]; j++)
+			{
+				Kernel::axpy(dot, sparse.values[j], lambda + sparse.states[j] * stride, stride);
+			}
+			sparse.rows++;
+			Kernel::multiplyAdd(message + digits[slot] * stride, weights + num_of_parents * stride, dot, stride);
+		}
+
+		k = num_of_parents - 1;
+		while (k >= 0 && ++digits[k] == model->getCardinality(parents[k]))
+		{
+			digits[k--] = 0;
+		}
+		if (k < 0)
+			break;
+	}
+
+	/*rescaling does not change the posteriors but keeps long chains from underflowing*/
+	normalize(message, model->getCardinality(parents[slot]));
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+updatePi() for a noisy-MAX CPT, in closed form (see Kernel::piEvidence()) :
+pi(x) is first P(X <= x), the leak times the effect of every parent weighed by its message,
+and then the difference of two of them.
+
+@param	v	the dense index of the vertex
+*/
+void BatchEngine::updateNoisyPi(int v)
+{
+	View<int> parents = model->getParents(v);
+	int first = model->getFirstEdge(v), num_of_parents = parents.getSize(), states = model->getCardinality(v);
+	const float *leak = model->getNoisy(v).parameters, *effect = leak + states;
+	float *pi = this->pi(v), *sum = scratch;
+
+	for (int x = 0; x < states; x++)
+	{
+		for (int s = 0; s < stride; s++)
+		{
+			pi[x * stride + s] = leak[x];
+		}
+	}
+
+	for (int k = 0; k < num_of_parents; k++)
+	{
+		int radix = model->getCardinality(parents[k]);
+		for (int x = 0; x < states; x++)
+		{
+			for (int s = 0; s < stride; s++)
+			{
+				sum[s] = 0;
+			}
+			for (int u = 0; u < radix; u++)
+			{
+				Kernel::axpy(sum, effect[u * states + x], piMessage(first + k) + u * stride, stride);
+			}
+			Kernel::multiply(pi + x * stride, sum, stride);
+		}
+		effect += radix * states;
+	}
+
+	/*rounding must not leave a difference of two cumulative values below 0*/
+	for (int x = states - 1; x > 0; x--)
+	{
+		Kernel::axpy(pi + x * stride, -1.0f, pi + (x - 1) * stride, stride);
+		for (int s = 0; s < stride; s++)
+		{
+			if (pi[x * stride + s] < 0)
+				pi[x * stride + s] = 0;
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+sendLambda() for a noisy-MAX CPT, in closed form (see Kernel::lambdaMessage()) :
+message(u) = sum over x of effect_slot(x | u) * G(x) * (lambda(x) - lambda(x + 1)),
+G(x) being the leak times the effect of every other parent weighed by its message.
+
+@param	e	the edge id
+*/
+void BatchEngine::sendNoisyLambda(int e)
+{
+	int c = model->getEdgeChild(e), states = model->getCardinality(c);
+	View<int> parents = model->getParents(c);
+	int first = model->getFirstEdge(c), num_of_parents = parents.getSize(), slot = e - first;
+	int radix = model->getCardinality(parents[slot]);
+	const float *leak = model->getNoisy(c).parameters, *own = leak + states;
+	float *lambda = this->lambda(c), *message = lambdaMessage(e);
+	float *weight = scratch, *sum = scratch + stride;
+
+	for (int k = 0; k < slot; k++)
+	{
+		own += model->getCardinality(parents[k]) * states;
+	}
+	for (int i = radix * stride - 1; i >= 0; i--)
+	{
+		message[i] = 0;
+	}
+
+	for (int x = 0; x < states; x++)
+	{
+		const float *effect = leak + states;
+		for (int s = 0; s < stride; s++)
+		{
+			weight[s] = leak[x];
+		}
+
+		for (int k = 0; k < num_of_parents; k++)
+		{
+			int size = model->getCardinality(parents[k]);
+			if (k != slot)
+			{
+				for (int s = 0; s < stride; s++)
+				{
+					sum[s] = 0;
+				}
+				for (int w = 0; w < size; w++)
+				{
+					Kernel::axpy(sum, effect[w * states + x], piMessage(first + k) + w * stride, stride);
+				}
+				Kernel::multiply(weight, sum, stride);
+			}
+			effect += size * states;
+		}
+
+		Kernel::scale(sum, lambda + x * stride, 1.0f, stride);
+		if (x + 1 < states)
+			Kernel::axpy(sum, -1.0f, lambda + (x + 1) * stride, stride);
+		Kernel::multiply(weight, sum, stride);
+
+		for (int u = 0; u < radix; u++)
+		{
+			Kernel::axpy(message + u * stride, own[u * states + x], weight, stride);
+		}
+	}
+
+	/*rescaling does not change the posteriors but keeps long chains from underflowing*/
+	normalize(message, radix);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the weight every context of a tree CPT starts with : the product of the sums of the pi messages
+of the parents. the messages are normalized, so this is 1 in a scenario unless its evidence
+is impossible, and a parent the tree does not test on the way to a leaf weighs no more.
+
+@param	c		the dense index of the vertex
+@param	slot	a parent left out, -1 for none
+@param	weight	one row of scenarios, the result
+*/
+void BatchEngine::treeWeight(int c, int slot, float *weight)
+{
+	View<int> parents = model->getParents(c);
+	int first = model->getFirstEdge(c);
+	float *sum = scratch + (ENGINE_MAX_PARENTS + 1) * stride;
+
+	for (int s = 0; s < stride; s++)
+	{
+		weight[s] = 1;
+	}
+
+	for (int k = 0; k < parents.getSize(); k++)
+	{
+		if (k == slot)
+			continue;
+
+		Kernel::scale(sum, piMessage(first + k), 1.0f, stride);
+		for (int u = 1; u < model->getCardinality(parents[k]); u++)
+		{
+			Kernel::add(sum, piMessage(first + k) + u * stride, stride);
+		}
+		Kernel::multiply(weight, sum, stride);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+updatePi() for a tree CPT : the tree is walked depth first, weights + d * stride holding the
+product of the messages of the states tested on the way down to the node at depth d, and every
+leaf adds its row times the weight of the context it ends. a tree tests a parent at most once
+on a path, so the walk never goes deeper than ENGINE_MAX_PARENTS.
+
+@param	v	the dense index of the vertex
+*/
+void BatchEngine::updateTreePi(int v)
+{
+	TreeTable<float> tree = model->getTree(v);
+	View<int> parents = model->getParents(v);
+	int first = model->getFirstEdge(v), states = model->getCardinality(v);
+	float *pi = this->pi(v), *weights = scratch;
+
+	int path[ENGINE_MAX_PARENTS + 1], digits[ENGINE_MAX_PARENTS + 1] = { 0 };
+
+	for (int i = states * stride - 1; i >= 0; i--)
+	{
+		pi[i] = 0;
+	}
+	treeWeight(v, -1, weights);
+
+	path[0] = 0;
+	for (int d = 0; d >= 0;)
+	{
+		int k = tree.nodes[path[d]];
+		if (k >= 0)
+		{
+			Kernel::multiply(weights + (d + 1) * stride, weights + d * stride, piMessage(first + k) + digits[d] * stride, stride);
+			path[d + 1] = tree.nodes[path[d] + 1 + digits[d]];
+			digits[++d] = 0;
+			continue;
+		}
+
+		const float *leaf = tree.leaves + (-1 - k) * states;
+		for (int x = 0; x < states; x++)
+		{
+			Kernel::axpy(pi + x * stride, leaf[x], weights + d * stride, stride);
+		}
+
+		d--;
+		while (d >= 0 && ++digits[d] == model->getCardinality(parents[tree.nodes[path[d]]]))
+		{
+			d--;
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+sendLambda() for a tree CPT, walking the tree like updateTreePi() with the parent the message
+goes to left out of the weights. a leaf below a test of that parent adds to the state tested,
+any other leaf to every state of the message.
+
+@param	e	the edge id
+*/
+void BatchEngine::sendTreeLambda(int e)
+{
+	int c = model->getEdgeChild(e), states = model->getCardinality(c);
+	TreeTable<float> tree = model->getTree(c);
+	View<int> parents = model->getParents(c);
+	int first = model->getFirstEdge(c), slot = e - first, radix = model->getCardinality(parents[slot]);
+	float *lambda = this->lambda(c), *message = lambdaMessage(e);
+	float *weights = scratch, *dot = scratch + (ENGINE_MAX_PARENTS + 1) * stride;
+
+	int path[ENGINE_MAX_PARENTS + 1], digits[ENGINE_MAX_PARENTS + 1] = { 0 };
+
+	for (int i = radix * stride - 1; i >= 0; i--)
+	{
+		message[i] = 0;
+	}
+	treeWeight(c, slot, weights);
+
+	path[0] = 0;
+	for (int d = 0; d >= 0;)
+	{
+		int k = tree.nodes[path[d]];
+		if (k >= 0)
+		{
+			if (k == slot)
+				Kernel::scale(weights + (d + 1) * stride, weights + d * stride, 1.0f, stride);
+			else
+				Kernel::multiply(weights + (d + 1) * stride, weights + d * stride, piMessage(first + k) + digits[d] * stride, stride);
+			path[d + 1] = tree.nodes[path[d] + 1 + digits[d]];
+			digits[++d] = 0;
+			continue;
+		}
+
+		const float *leaf = tree.leaves + (-1 - k) * states;
+		Kernel::scale(dot, lambda, leaf[0], stride);
+		for (int x = 1; x < states; x++)
+		{
+			Kernel::axpy(dot, leaf[x], lambda + x * stride, stride);
+		}
+
+		int tested = -1;
+		for (int j = 0; j < d; j++)
+		{
+			tested = tree.nodes[path[j]] == slot ? digits[j] : tested;
+		}
+		for (int u = 0; u < radix; u++)
+		{
+			if (tested < 0 || tested == u)
+				Kernel::multiplyAdd(message + u * stride, weights + d * stride, dot, stride);
+		}
+
+		d--;
+		while (d >= 0 && ++digits[d] == model->getCardinality(parents[tree.nodes[path[d]]]))
+		{
+			d--;
+		}
+	}
+
+	/*rescaling does not change the posteriors but keeps long chains from underflowing*/
+	normalize(message, radix);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the message from the parent of an edge to its child :
+message(x) = alpha * pi(x) * evidence(x) * product of the lambda messages from the other children
+
+@param	e	the edge id
+*/
+void BatchEngine::sendPi(int e)
+{
+	int u = model->getEdgeParent(e), states = model->getCardinality(u);
+	float *pi = this->pi(u), *message = piMessage(e);
+	int *observed = evidence + u * stride;
+
+	for (int x = 0; x < states; x++)
+	{
+		for (int s = 0; s < stride; s++)
+		{
+			message[x * stride + s] = (observed[s] < 0 || observed[s] == x) ? pi[x * stride + s] : 0.0f;
+		}
+	}
+
+	View<int> edges = model->getChildEdges(u);
+	for (int j = 0; j < edges.getSize(); j++)
+	{
+		if (edges[j] != e)
+			Kernel::multiply(message, lambdaMessage(edges[j]), states * stride);
+	}
+
+	normalize(message, states);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+sends the pi messages of a vertex to all its children but one, with the products of the lambda
+messages of the children after each one built backwards and those before it carried forwards,
+so that a vertex with d children costs O(d) and not O(d^2)
+
+@param	u		the dense index of the vertex
+@param	back	the edge which gets no message, or -1
+*/
+void BatchEngine::sendPi(int u, int back)
+{
+	int states = model->getCardinality(u);
+	float *pi = this->pi(u), *next = NULL, *after = NULL;
+	int *observed = evidence + u * stride;
+	View<int> edges = model->getChildEdges(u);
+
+	for (int j = edges.getSize() - 1; j >= 0; j--)
+	{
+		if (edges[j] == back)
+			continue;
+
+		float *message = piMessage(edges[j]);
+		if (next)
+		{
+			Kernel::multiply(message, next, after, states * stride);
+		}
+		else
+		{
+			for (int i = 0; i < states * stride; i++)
+			{
+				message[i] = 1.0f;
+			}
+		}
+		next = message;
+		after = lambdaMessage(edges[j]);
+	}
+
+	for (int x = 0; x < states; x++)
+	{
+		for (int s = 0; s < stride; s++)
+		{
+			prefix[x * stride + s] = (observed[s] < 0 || observed[s] == x) ? pi[x * stride + s] : 0.0f;
+		}
+	}
+	if (back >= 0 && model->getEdgeParent(back) == u)
+		Kernel::multiply(prefix, lambdaMessage(back), states * stride);
+
+	for (int j = 0; j < edges.getSize(); j++)
+	{
+		if (edges[j] == back)
+			continue;
+
+		float *message = piMessage(edges[j]);
+		Kernel::multiply(message, prefix, states * stride);
+		Kernel::multiply(prefix, lambdaMessage(edges[j]), states * stride);
+		normalize(message, states);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	scenario	the zero-based index of the scenario
+@param	v			the dense index of the vertex
+@param	state		the one-based index of the state
+@return				the posterior probability of the state in that scenario after the last propagate()
+*/
+float BatchEngine::p(int scenario, int v, int state)
+{
+	if (scenario < 0 || scenario >= scenarios || v < 0 || v >= model->getSize() || state < 1 || state > model->getCardinality(v))
+		throw - 1;
+
+	return belief(v)[(state - 1) * stride + scenario];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+copies the posterior probabilities of a vertex in every scenario
+
+@param	v		the dense index of the vertex
+@param	matrix	filled with scenarios x states values, one row per scenario
+*/
+void BatchEngine::posterior(int v, float *matrix)
+{
+	int states = model->getCardinality(v);
+	float *values = belief(v);
+
+	for (int s = 0; s < scenarios; s++)
+	{
+		for (int x = 0; x < states; x++)
+		{
+			matrix[s * states + x] = values[x * stride + s];
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+BatchEngine::~BatchEngine()
+{
+	delete[] evidence;
+	delete[] vertex_offsets;
+	delete[] edge_offsets;
+	delete[] messages;
+	delete[] scratch;
+	delete[] prefix;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif
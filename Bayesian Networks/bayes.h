@@ -5,33 +5,88 @@
 
 #include <iostream>
 #include <iomanip>
+#include <cmath>
+#include <cstring>
+#include <atomic>
 #include "linkedlist.h"
 #include "vector.h"
 #include "state.h"
+#include "kernels.h"
+#include "arena.h"
 
 using namespace std;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 class Vertex;
 
+/*alignment (in bytes) of the flat CPT buffer*/
+#define CPD_ALIGNMENT 64
+
+/*how far the sum of a row given to CPD::setTable() without normalizing may be from 1*/
+#define CPD_TOLERANCE 1e-3f
+
+/*how a CPD is kept, see CPD::getKind()*/
+#define CPD_TABLE 0
+#define CPD_NOISY_MAX 1
+#define CPD_TREE 2
+
 class CPD
 {
 private:
 
-	Vector< Vector<float> > table;//for the 2-d array
+	/*the 2-d array, stored row by row in one contiguous aligned buffer.
+	entry (state, row) lives at table[row * width + state]*/
+	float *table;
 	Vertex *vertex;
 	int height, width;//height and width of the table
 
+	/*CPD_TABLE, or CPD_NOISY_MAX : there is no table then (height is 0) and the CPD is given
+	by one row of parameters per state of every parent, laid out as NoisyTable::parameters,
+	or CPD_TREE : no table either, the CPD is a decision tree over the parents laid out as
+	TreeTable::nodes and its leaves, one row of width probabilities each*/
+	int kind;
+	float *parameters;
+	int *tree, tree_size;
+	float *leaves;
+	int num_of_leaves;
+
+	/*mixed-radix description of the parents:
+	radices[k] is the number of states of the k-th parent and
+	strides[k] is the distance between two consecutive rows of that parent*/
+	int num_of_parents;
+	int *radices;
+	int *strides;
+
+	void setStrides();
+
+	bool fill(float *target, const float *values, bool normalize);
+
+	float cumulative(int x, const int *combo);
+
+	const float * leaf(const int *combo);
+
+	static void accumulate(float *target, const float *row, int width);
+
+	void displayEffect(const float *effect);
+
+	void displayContext(int position, string context);
+
+	void setKind(int kind);
+
+	int parseTree(const int *nodes, int size, int &position, Vector<int> &output, Vector<char> &tested, int count);
+
 public:
 
 	CPD(Vertex *);
 
+	static float * allocate(int size);
+
+	static void release(float *buffer);
+
 	void setValues();
 
 	void initialize();
 
-	void generateStates(Node<Vertex *> *, int &, LinkedList<State *> *, LinkedList<State *> *, bool &);
-
 	void display();
 
 	void displayRow(int);
@@ -50,6 +105,8 @@ public:
 
 	int row(LinkedList<State *> *);
 
+	int row(int *combo);
+
 	float p(int n, int *combo);
 
 	float p(int n, LinkedList<State *> *combo);
@@ -57,11 +114,37 @@ public:
 	void resetTable();
 
 	void resetTable(CPD* new_table);
+
+	void setTable(const float *values, int size, bool normalize);
+
+	void adoptTable(float *values, int size, bool normalize);
+
+	void setNoisyMax(const float *effects, int size, const float *leak);
+
+	void setNoisyOr(const float *probabilities, int size, float leak);
+
+	void setTree(const int *nodes, int size, const float *values, int count, bool normalize);
 	
 	void reset(Node<Vertex *> *ptr, LinkedList<State *> *combo);
 
 	void setValue(int, int, float);
 
+	int getHeight();
+
+	int getWidth();
+
+	float * getTable();
+
+	int * getRadices();
+
+	int scratchSize();
+
+	int getKind();
+
+	float * getParameters();
+
+	TreeTable<float> getTree();
+
 	~CPD();
 
 };
@@ -136,6 +219,14 @@ private:
 
 	bool flag;//true if the node is observed...
 
+	int evidence;//the one-based index of the observed state, 0 if not observed
+
+	unsigned int stamp;//the last Schedule which reached this vertex
+
+	Arena *arena;//the arena of the Graph the vertex was added to, NULL if none
+
+	unsigned int *revision;//the revision of that Graph, NULL if none
+
 	Vector<float> lambda_evidence; 
 
 	Vector<float> pi_evidence; 
@@ -144,6 +235,45 @@ private:
 
 	Vector< Vector<float> > pi_messages;//the evidence from the parent to the child
 
+	/*the parents and the children of the vertex,
+	rebuilt from the edges whenever an edge is added*/
+	Vector<Vertex *> parents;
+
+	Vector<Vertex *> children;
+
+	/*parent_slots[k] is the index of this vertex among the children of its k-th parent,
+	child_slots[j] is the index of this vertex among the parents of its j-th child*/
+	Vector<int> parent_slots;
+
+	Vector<int> child_slots;
+
+	/*scratch space for the addresses of the pi messages, handed to the kernels*/
+	Vector<const float *> factors;
+
+	/*lazy propagation : stale_pi[k] (stale_lambda[j]) is 1 while the message from the k-th parent
+	(j-th child) is out of date. a stale message means every message beyond it, leading away from
+	its sender, is stale too. the evidence vectors and the posterior are only recomputed when
+	something they depend on has changed and they are read.*/
+	Vector<char> stale_pi;
+
+	Vector<char> stale_lambda;
+
+	bool pi_dirty, lambda_dirty, posterior_dirty;
+
+	void send(Vertex *receiver);
+
+	void settle();
+
+	void updateAdjacency();
+
+	void updateSlots();
+
+	int parentIndex(Vertex *parent);
+
+	int childIndex(Vertex *child);
+
+	friend class Schedule;
+
 public:
 
 	Vertex();
@@ -156,6 +286,14 @@ public:
 
 	CPD * getCPD();
 
+	Arena & getArena();
+
+	void setArena(Arena *arena);
+
+	void setRevision(unsigned int *revision);
+
+	void touch();
+
 	void setTable();
 
 	int getWeight();
@@ -180,10 +318,18 @@ public:
 
 	void getChildren(LinkedList< Vertex *> * children);
 
+	View<Vertex *> getParents();
+
+	View<Vertex *> getChildren();
+
 	bool operator == (const Vertex& VERTEX);
 
 	void observe(int state);
 
+	void setEvidence(int state);
+
+	void clearEvidence();
+
 	void resetTable();
 
 	float p(int n, LinkedList<State *> *combo);
@@ -200,7 +346,7 @@ public:
 
 	float piEvidence(State *state);
 
-	void piEvidence(Node<Vertex *> *ptr, LinkedList<State *> *combo, float &sum, int &n);
+	void piEvidence(float *evidence);
 
 	float piEvidence(State state);
 
@@ -231,7 +377,7 @@ public:
 
 	float lambdaMessage(int child, int state);
 
-	void lambdaMessage(Node<Vertex *> *ptr, LinkedList<State *> *combo, Vertex *my_child, State *my_state, float &sum);
+	void lambdaMessage(int child, float *message);
 
 	float lambdaMessage(Vertex *child, State *state);
 
@@ -257,6 +403,12 @@ public:
 
 	void posteriorProbabilities();
 
+	void invalidate();
+
+	void update();
+
+	float getPosterior(int state);
+
 	void initialize();
 
 	void setMontyTable(CPD *monty_hall_table)
@@ -269,6 +421,99 @@ public:
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/*an explicit two pass propagation schedule over a polytree.
+the vertices are kept in breadth first order over the undirected graph,
+so walking the order backwards sends every message towards the first vertex (collect)
+and walking it forwards sends every other message away from it (distribute).
+every message is computed exactly once per run and nothing recurses.*/
+class Schedule
+{
+private:
+
+	/*counts the schedules built so far, used to mark visited vertices.
+	atomic, as graphs are scheduled on several threads at once*/
+	static atomic<unsigned int> count;
+
+	/*the arena of the vertices. order and links live in it,
+	it is reset when the last living schedule is destroyed*/
+	Arena *arena;
+
+	Vertex **order;
+
+	/*how order[i] was reached : +k if from its k-th parent,
+	-j if from its j-th child (both one-based), 0 if it is the first of its tree*/
+	int *links;
+
+	int size, capacity;
+
+	void initialize(Arena &arena);
+
+	void push(Vertex *vertex, int link);
+
+	void add(Vertex *start, unsigned int stamp);
+
+public:
+
+	Schedule(Vertex *start);
+
+	Schedule(LinkedList<Vertex *> *vertices, Arena &arena);
+
+	Schedule(Vertex **starts, int size);
+
+	int getSize();
+
+	void collect();
+
+	void distribute();
+
+	void run();
+
+	~Schedule();
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*the work list of Vertex::invalidate() and Vertex::update() : a stack of messages, each from a
+sender to a neighbouring receiver. like a Schedule it lives in the arena of the vertices and
+moves to a block twice as large when full, so once the arena has grown to fit it a walk takes nothing
+from the heap.*/
+class MessageStack
+{
+private:
+
+	struct Message
+	{
+		Vertex *sender, *receiver;
+		bool expanded;
+	};
+
+	Arena *arena;
+	Message *items;
+	int size, capacity;
+
+public:
+
+	MessageStack(Arena &arena);
+
+	void push(Vertex *sender, Vertex *receiver);
+
+	void pop();
+
+	bool isEmpty();
+
+	Vertex * getSender();
+
+	Vertex * getReceiver();
+
+	bool isExpanded();
+
+	void expand();
+
+	~MessageStack();
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 /*static variable initialization*/
 int Vertex::count = 0;
 
@@ -300,6 +545,9 @@ Vertex::Vertex(string name, int weight, int num_of_states)
 		s.setState("State" + to_string(s.id), (float) 1.00f / num_of_states);
 	}
 	this->weight = weight;
+	stamp = 0;
+	arena = NULL;
+	revision = NULL;
 	table = new CPD(this);
 
 	initialize();
@@ -332,6 +580,53 @@ CPD * Vertex::getCPD()
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 
+/*
+@return		the arena the temporaries of a propagation through the vertex come from :
+			the one of its Graph, or Arena::shared() if it was never added to one
+*/
+Arena & Vertex::getArena()
+{
+	return arena ? *arena : Arena::shared();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+called by the Graph the vertex is added to
+
+@param	arena	the arena of the Graph, it must outlive every propagation through the vertex
+*/
+void Vertex::setArena(Arena *arena)
+{
+	this->arena = arena;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+called by the Graph the vertex is added to
+
+@param	revision	the revision of the Graph (see Graph::getRevision()), bumped by touch()
+*/
+void Vertex::setRevision(unsigned int *revision)
+{
+	this->revision = revision;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+counts a change to the table of the vertex in the revision of its Graph :
+its CPD calls it whenever the table is set, reset, resized by a new parent or refilled
+*/
+void Vertex::touch()
+{
+	if (revision)
+		(*revision)++;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
 /*set the
 data of the vertice*/
 void Vertex::setTable()
@@ -385,6 +680,11 @@ void Vertex::connectTo(Vertex *child, int weight)
 	{
 		this->pointers->append(edge);
 		(child->pointers)->append(edge);
+
+		updateAdjacency();
+		child->updateAdjacency();
+		updateSlots();
+		child->updateSlots();
 	}
 	child->table->initialize();
 }
@@ -408,6 +708,7 @@ display all the states with their probabilities
 */
 void Vertex::displayStates()
 {
+	update();
 	cout << "\nStates of Vertex :\t" << getName() << endl;
 	Node<State> *ptr = states->getHead();
 
@@ -463,19 +764,14 @@ gives a linked list consisting of the parents of the current node
 */
 void Vertex::getParents(LinkedList< Vertex *> *parents)
 {
-	Node<Edge *> *ptr = pointers->getHead();
 	parents->clear();
-	while (ptr)
+	for (Vertex **ptr = this->parents.begin(); ptr != this->parents.end(); ptr++)
 	{
-		if (ptr->data->getOrigin() != this && ptr->data->getDestination() == this)
-		{
-			parents->append(ptr->data->getOrigin());
-		}
-		ptr = ptr->next;
+		parents->append(*ptr);
 	}
 }
 
-//--------------------------------------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
 
 /*
 gives a linked list consisting of the children of the current node
@@ -483,20 +779,119 @@ gives a linked list consisting of the children of the current node
 */
 void Vertex::getChildren(LinkedList< Vertex *> * children)
 {
-	Node<Edge *> *ptr = pointers->getHead();
 	children->clear();
-	while (ptr)
+	for (Vertex **ptr = this->children.begin(); ptr != this->children.end(); ptr++)
+	{
+		children->append(*ptr);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		a view of the parents of the current node, in the order they were connected.
+the view stays valid until the next edge is added to this vertex.
+*/
+View<Vertex *> Vertex::getParents()
+{
+	return View<Vertex *>(parents.begin(), parents.getSize());
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		a view of the children of the current node, in the order they were connected.
+the view stays valid until the next edge is added to this vertex.
+*/
+View<Vertex *> Vertex::getChildren()
+{
+	return View<Vertex *>(children.begin(), children.getSize());
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+rebuilds the parents and children arrays by scanning the edges once.
+called whenever an edge is added to the vertex.
+*/
+void Vertex::updateAdjacency()
+{
+	parents.clear();
+	children.clear();
+	factors.clear();
+
+	for (Node<Edge *> *ptr = pointers->getHead(); ptr; ptr = ptr->next)
 	{
+		if (ptr->data->getOrigin() != this && ptr->data->getDestination() == this)
+		{
+			parents.pushBack(ptr->data->getOrigin());
+			factors.pushBack(NULL);
+		}
 		if (ptr->data->getOrigin() == this && ptr->data->getDestination() != this)
 		{
-			children->append(ptr->data->getDestination());
+			children.pushBack(ptr->data->getDestination());
 		}
-		ptr = ptr->next;
 	}
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
 
+/*
+finds where this vertex sits in the adjacency arrays of its neighbours.
+the neighbours' arrays must already be up to date.
+*/
+void Vertex::updateSlots()
+{
+	parent_slots.clear();
+	child_slots.clear();
+
+	for (int k = 0; k < (int)parents.getSize(); k++)
+	{
+		parent_slots.pushBack(parents[k]->childIndex(this));
+	}
+
+	for (int j = 0; j < (int)children.getSize(); j++)
+	{
+		child_slots.pushBack(children[j]->parentIndex(this));
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	parent	a pointer to a parent of this vertex
+
+@return		the zero-based index of the parent, -1 if it is not a parent
+*/
+int Vertex::parentIndex(Vertex *parent)
+{
+	for (int k = parents.getSize() - 1; k >= 0; k--)
+	{
+		if (parents[k] == parent)
+			return k;
+	}
+	return -1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	child	a pointer to a child of this vertex
+
+@return		the zero-based index of the child, -1 if it is not a child
+*/
+int Vertex::childIndex(Vertex *child)
+{
+	for (int j = children.getSize() - 1; j >= 0; j--)
+	{
+		if (children[j] == child)
+			return j;
+	}
+	return -1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
+
 /*one Vertex is equal to another if its weight are equal to each other
 and they have the same Connections*/
 bool Vertex::operator == (const Vertex& VERTEX)
@@ -515,12 +910,30 @@ the descendents of the current node.....
 
 */
 void Vertex::observe(int state)
+{
+	setEvidence(state);
+
+	Schedule(this).run();
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+sets the given index of the state's probability to 1 without
+propagating it. the rest of the graph is stale until a Schedule is run.
+
+@param	state	the index of the linked list of the states
+
+*/
+void Vertex::setEvidence(int state)
 {
 	if (state < 1 || state > states->getSize())
 		throw - 1;
 
 	Node<State> *ptr = states->getHead();
 
+	evidence = state;
+
 	while (ptr)
 	{
 		if (--state)
@@ -536,29 +949,18 @@ void Vertex::observe(int state)
 	}
 
 	flag = true;
+}
 
-	lambdaEvidence();
-
-	for (int i = 0; i < this->getStates()->getSize(); i++)
-		cout << lambda_evidence[i] << endl;
-
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
-	getParents(parents);
-	LinkedList<Vertex *> *children = new LinkedList<Vertex *>();
-	getChildren(children);
-	Node<Vertex *> *parent = parents->getHead(), *child = children->getHead();
-
-	while (parent)
-	{
-		parent->data->lambdaMessage(this);
-		parent = parent->next;
-	}
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
 
-	while (child)
-	{
-		child->data->piMessage(this);
-		child = child->next;
-	}
+/*
+forgets the observation of the vertex without propagating it.
+the posterior probabilities are recomputed by the next Schedule which is run.
+*/
+void Vertex::clearEvidence()
+{
+	flag = false;
+	evidence = 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -652,11 +1054,7 @@ fills all the pi_evidence vector with valid values...
 */
 void Vertex::piEvidence()
 {
-	int size = getStates()->getSize();
-	for (int i = 0; i < size; i++)
-	{
-		pi_evidence[i] = piEvidence(i + 1);
-	}
+	piEvidence(pi_evidence.begin());
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -666,7 +1064,7 @@ calculates a value for the pi-evidence
 
 please refer to 
 
-void Vertex::piEvidence(Node<Vertex *> *ptr, LinkedList<State *> *combo, float &sum, int &n)
+void Vertex::piEvidence(float *evidence)
 
 @param	n	an index to the linkedlist<state>
 
@@ -675,15 +1073,18 @@ void Vertex::piEvidence(Node<Vertex *> *ptr, LinkedList<State *> *combo, float &
 */
 float Vertex::piEvidence(int n)
 {
-	float sum = 0;
+	if (n < 1 || n > states->getSize())
+		throw - 1;
+
+	Arena &arena = getArena();
+	arena.enter();
 
-	LinkedList<Vertex *> *parent = new LinkedList<Vertex *>();
-	getParents(parent);
-	Node<Vertex *> *ptr = parent->getHead();
-	LinkedList<State *> *combo = new LinkedList<State *>();
+	float *evidence = arena.allocate<float>(states->getSize());
+	piEvidence(evidence);
+	float value = evidence[n - 1];
 
-	piEvidence(ptr, combo, sum, n);
-	return sum;
+	arena.leave();
+	return value;
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -693,7 +1094,7 @@ calculates a value for the pi-evidence
 
 please refer to
 
-void Vertex::piEvidence(Node<Vertex *> *ptr, LinkedList<State *> *combo, float &sum, int &n)
+void Vertex::piEvidence(float *evidence)
 
 @param	state	a pointer to the state whose piEvidence is to be calculates
 
@@ -708,43 +1109,49 @@ float Vertex::piEvidence(State *state)
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
 
 /*
-calculates the piEvidence for a node
+calculates the piEvidence for every state of the node in one pass over the CPT
+(or over the parameters of a noisy-MAX CPD).
+please refer to
+
+void Kernel::piEvidence(const float *table, int height, int width, const int *radices, int count,
+	const float * const *pi, float *scratch, float *evidence)
 
-@param	ptr		a pointer to the parents linkedlist
-@param	combo	an initially empty linked list to be filled later with combinations
-@param	sum		the probability to be calculated
-@param	n		the index of the state. gives how much are the levels of recursion
+the scratch of the kernels is taken from the arena and given back right away.
+
+@param	evidence	the result, one value per state
 
 */
-void Vertex::piEvidence(Node<Vertex *> *ptr, LinkedList<State *> *combo, float &sum, int &n)
+void Vertex::piEvidence(float *evidence)
 {
-	if (!ptr)
+	for (int k = parents.getSize() - 1; k >= 0; k--)
 	{
-		Node<State *> *s = combo->getHead();
-
-		float num = p(n, combo);
+		factors[k] = pi_messages[k].begin();
+	}
 
-		int i = 1;
-		while (s)
-		{
-			num *= pi_messages[i - 1][s->data->id - 1];
-			s = s->next;
-			i++;
-		}
+	Arena &arena = getArena();
+	arena.enter();
+	size_t mark = arena.mark();
+	float *scratch = arena.allocate<float>(table->scratchSize());
 
-		sum += num;
+	if (table->getKind() == CPD_NOISY_MAX)
+	{
+		NoisyTable<float> noisy = { table->getParameters() };
+		Kernel::piEvidence(noisy, table->getWidth(), table->getRadices(), parents.getSize(),
+			factors.begin(), scratch, evidence);
+	}
+	else if (table->getKind() == CPD_TREE)
+	{
+		Kernel::piEvidence(table->getTree(), table->getWidth(), table->getRadices(), parents.getSize(),
+			factors.begin(), scratch, evidence);
 	}
 	else
 	{
-		Node<State> *p = ptr->data->getStates()->getHead();
-		while (p)
-		{
-			combo->append(&(p->data));
-			piEvidence(ptr->next, combo, sum, n);
-			combo->removeLast();
-			p = p->next;
-		}
+		Kernel::piEvidence(table->getTable(), table->getHeight(), table->getWidth(), table->getRadices(), parents.getSize(),
+			factors.begin(), scratch, evidence);
 	}
+
+	arena.rewind(mark);
+	arena.leave();
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -754,7 +1161,7 @@ calculates a value for the pi-evidence
 
 please refer to
 
-void Vertex::piEvidence(Node<Vertex *> *ptr, LinkedList<State *> *combo, float &sum, int &n)
+void Vertex::piEvidence(float *evidence)
 
 @param	state	a state whose piEvidence is to be calculates
 
@@ -772,36 +1179,23 @@ float Vertex::piEvidence(State state)	//may not work!!!!!!!!!!
 fills the messages from the paents to the children for this node
 
 please refer to 
-float Vertex::piMessage(Vertex *parent, State *state)
+void Vertex::piMessage(int parent)
 
 */
 void Vertex::piMessages()
 {
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
-	getParents(parents);
-	Node<Vertex *> *ptr = parents->getHead();
-	Node<State> *state;
-
-	int i = 0, j;
-	while (ptr)
+	for (int k = 1; k <= (int)parents.getSize(); k++)
 	{
-		state = ptr->data->getStates()->getHead();
-		j = 0;
-		while (state)
-		{
-			pi_messages[i][j] = piMessage(ptr->data, &(state->data));
-			state = state->next;
-			j++;
-		}
-		ptr = ptr->next;
-		i++;
+		piMessage(k);
 	}
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
 
 /*
-calculates the probability - the message from the parent to the child
+calculates the probability - the message from the parent to the child,
+up to a normalizing constant :
+pi(state) * product of the lambda messages the parent got from its other children
 
 @param	parent		the index of the parent in the parents' linked list
 @param	state		the index of the state in the states' linked list
@@ -810,41 +1204,32 @@ calculates the probability - the message from the parent to the child
 */
 float Vertex::piMessage(int parent, int state)
 {
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
-	getParents(parents);
-	Node<Vertex *> *ptr = parents->getHead();
-
-	if (parent < 1 || parent > parents->getSize() || state < 1)
+	if (parent < 1 || parent > (int)parents.getSize() || state < 1)
 		throw - 1;
 
+	Vertex *ptr = parents[parent - 1];
 
-	int par = parent;
-	while (--par)
-	{
-		ptr = ptr->next;
-	}
-
-	if (state > ptr->data->getStates()->getSize())
+	if (state > ptr->getStates()->getSize())
 		throw - 1;
 
-	if (ptr->data->isObserved())
+	if (ptr->isObserved())
 	{
-		if (ptr->data->isObserved(state))
+		if (ptr->isObserved(state))
 			return 1;
 		else
 			return 0;
 	}
 
-	Node<State> *p = ptr->data->getStates()->getHead();
-
-	int s = state;
+	float product = ptr->pi_evidence[state - 1];
+	int me = parent_slots[parent - 1];
 
-	while (--s)
+	for (int j = ptr->children.getSize() - 1; j >= 0; j--)
 	{
-		p = p->next;
+		if (j != me)
+			product *= ptr->lambda_messages[j][state - 1];
 	}
 
-	return p->data.probability / lambda_messages[parent - 1][state - 1];
+	return product;
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -855,7 +1240,7 @@ please refer to
 float Vertex::piMessage(int parent, int state)
 
 @param	parent		a pointer to the parent vertex
-@param	state		a pointer to the state of this node
+@param	state		a pointer to the state of the parent
 
 @return		the piMessage
 */
@@ -868,10 +1253,13 @@ float Vertex::piMessage(Vertex *parent, State *state)//*************************
 
 /*
 calculates the message from the parent to the child.
+
+@param	parent		the index of the parent in the parents' linked list
+@param	state		a pointer to the state of the parent
 */
 float Vertex::piMessage(int parent, State *state)/////***************************************
 {
-	return state->probability / lambda_messages[parent][state->id - 1];
+	return piMessage(parent, state->id);
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -880,29 +1268,7 @@ float Vertex::piMessage(int parent, State *state)/////**************************
 the piMessage*/
 float Vertex::piMessage(Vertex *parent, int state)
 {
-	Node<State> *p = parent->getStates()->getHead();
-
-	if (state < 1 || state > parent->getStates()->getSize())
-		throw - 1;
-
-	int s = state;
-	while (--s)
-	{
-		p = p->next;
-	}
-
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
-	getParents(parents);
-	Node<Vertex *> *ptr = parents->getHead();
-
-	int parent_ = 0;
-	while (ptr->data != parent)
-	{
-		parent_++;
-		ptr = ptr->next;
-	}
-
-	return p->data.probability / lambda_messages[parent_][state - 1];//****************************************
+	return piMessage(parentIndex(parent) + 1, state);
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -912,14 +1278,9 @@ calculates te piMessage for a parent for all of its children.
 */
 void Vertex::piMessage()//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-==-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 {
-	LinkedList<Vertex *> *children = new LinkedList<Vertex *>();
-	getChildren(children);
-	Node<Vertex *> *child = children->getHead();
-
-	while (child)
+	for (int j = 0; j < (int)children.getSize(); j++)
 	{
-		child->data->piMessage(this);
-		child = child->next;
+		children[j]->piMessage(child_slots[j] + 1);
 	}
 }
 
@@ -933,45 +1294,34 @@ calculates the piMessage accordin to the formula
 */
 void Vertex::piMessage(Vertex *parent)//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-==-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 {
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
-	getParents(parents);
-	LinkedList<Vertex *> *children = new LinkedList<Vertex *>();
-	getChildren(children);
-	Node<Vertex *> *ptr = parents->getHead();
-	Node<Vertex *> *child = children->getHead();
+	piMessage(parentIndex(parent) + 1);
+}
 
-	int j = 0;
-	while (ptr->data != parent)
-	{
-		j++;
-		ptr = ptr->next;
-	}
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
 
-	for (int i = parent->states->getSize(); i; i--)
-	{
-		pi_messages[j][i - 1] = piMessage(parent, i);
-	}
+/*
+recomputes the message from one parent and normalizes it.
+only this message is touched, the propagation itself is driven by a Schedule.
 
-	if (!flag)
-	{
-		piEvidence();
-		posteriorProbabilities();
+@param	parent	the one-based index of the parent in the parents array
 
-		while (child)
-		{
-			child->data->piMessage(this);
-			child = child->next;
-		}
-	}
-	else if (true)//////////////////////////////////////////???
+*/
+void Vertex::piMessage(int parent)
+{
+	int j = parent - 1, size = parents[j]->getStates()->getSize();
+	float sum = 0;
+
+	for (int i = 0; i < size; i++)
 	{
-		parents->findAndRemove(parent);
-		ptr = parents->getHead();
+		pi_messages[j][i] = piMessage(parent, i + 1);
+		sum += pi_messages[j][i];
+	}
 
-		while (ptr)
+	if (sum > 0)
+	{
+		for (int i = 0; i < size; i++)
 		{
-			ptr->data->lambdaMessage(this);
-			ptr = ptr->next;
+			pi_messages[j][i] /= sum;
 		}
 	}
 }
@@ -979,75 +1329,48 @@ void Vertex::piMessage(Vertex *parent)//=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
 
 
-void Vertex::piMessage(int parent)
-{
+/*
+calculates the lambdaMessage - the message a child vertex passed to it to the parents
 
+@param	child		the pointer to a single child node
+*/
+void Vertex::lambdaMessage(Vertex *child)
+{
+	lambdaMessage(childIndex(child) + 1);
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
 
-
 /*
-calculates the lambdaMessage - the message a child vertex passed to it to the parents
+recomputes the message from one child and normalizes it.
+only this message is touched, the propagation itself is driven by a Schedule.
 
-@param	child		the pointer to a single child node
+@param	child		the one-based index of the child in the children array
 */
-void Vertex::lambdaMessage(Vertex *child)
+void Vertex::lambdaMessage(int child)
 {
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
-	getParents(parents);
-	LinkedList<Vertex *> *children = new LinkedList<Vertex *>();
-	getChildren(children);
-	Node<Vertex *> *ptr = parents->getHead();
-	Node<Vertex *> *p = children->getHead();
+	int j = child - 1;
+	float sum = 0;
 
-	int j = 0;
-	while (p->data != child)
-	{
-		j++;
-		p = p->next;
-	}
+	lambdaMessage(child, lambda_messages[j].begin());
 
 	for (int i = states->getSize(); i; i--)
 	{
-		lambda_messages[j][i-1] = lambdaMessage(child, i);
+		sum += lambda_messages[j][i - 1];
 	}
 
-	if (!flag)
+	/*rescaling does not change any posterior but keeps long chains from underflowing*/
+	if (sum > 0)
 	{
-		lambdaEvidence();
-		posteriorProbabilities();
-
-		while (ptr)
-		{
-			ptr->data->lambdaMessage(this);
-			ptr = ptr->next;
-		}
-
-		children->findAndRemove(child);
-		p = children->getHead();
-		while (p)
+		for (int i = states->getSize(); i; i--)
 		{
-			p->data->piMessage(this);
-			p = p->next;
+			lambda_messages[j][i - 1] /= sum;
 		}
 	}
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
 
-/*
-an overloaded function . please refer to 
-
-void Vertex::lambdaMessage(Vertex* child)
-*/
-void Vertex::lambdaMessage(int child)
-{
-
-}
-
-//---------------------------------------------------------------------------------------------------------------------------------------------------------
-
 /*
 responsible for probability propagation
 makes the probability of the state of the vertex equal to 1
@@ -1055,36 +1378,7 @@ and updates all other nodes (ancestors and descendents)
 */
 void Vertex::observe(State *state)
 {
-	state->probability = 1;
-
-	Node<State> *s = states->getHead();
-	while (s)
-	{
-		if (&(s->data) != state)
-		{
-			s->data.probability = 0;
-		}
-	}
-	lambdaEvidence();
-
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
-	getParents(parents);
-	LinkedList<Vertex *> *children = new LinkedList<Vertex *>();
-	getChildren(children);
-	Node<Vertex *> *ptr = parents->getHead();
-	Node<Vertex *> *p = children->getHead();
-
-	while (ptr)
-	{
-		ptr->data->lambdaMessage(this);
-		ptr = ptr->next;
-	}
-
-	while (p)
-	{
-		p->data->piMessage(this);
-		p = p->next;
-	}
+	observe(table->column(state) + 1);
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -1098,20 +1392,9 @@ float Vertex::lambdaMessage(Vertex *child, int state)
 */
 void Vertex::lambdaMessages()
 {
-	LinkedList<Vertex *> *children = new LinkedList<Vertex *>();
-	getChildren(children);
-	Node<Vertex *> *ptr = children->getHead();
-	int states = getStates()->getSize();
-
-	int i = 0;
-	while (ptr)
+	for (int i = 0; i < (int)children.getSize(); i++)
 	{
-		for (int j = 0; j < states; j++)
-		{
-			lambda_messages[i][j] = lambdaMessage(ptr->data, j + 1);
-		}
-		ptr = ptr->next;
-		i++;
+		lambdaMessage(i + 1, lambda_messages[i].begin());
 	}
 }
 
@@ -1148,69 +1431,59 @@ float Vertex::lambdaMessage(int child, int state)
 
 /*
 does all the work
-calculates a message for all the children to the parents
+computes the whole message from a child with one contraction of the child's CPT,
+or in closed form from the parameters of a noisy-MAX CPD.
+please refer to
+
+void Kernel::lambdaMessage(const float *table, int width, const int *radices, int count, int slot,
+	const float * const *pi, const float *lambda, float *scratch, float *message)
 
-@param	ptr			the pointer to the head of the siblings linked list
-@param	combo		the initially empty linkedlist later to be filled with the combinations of the parents
-@param	my_child	the pointer to the current child
-@param	my_state	the pointer to the current state
-@param	sum			the sum i.e. the actual lambda message
+the scratch of the kernels is taken from the arena and given back right away.
+
+@param	child		the one-based index of the child in the children array
+@param	message		the result, one (not normalized) value per state of this vertex
 */
-void Vertex::lambdaMessage(Node<Vertex *> *ptr, LinkedList<State *> *combo, Vertex *my_child, State *my_state, float &sum)
+void Vertex::lambdaMessage(int child, float *message)
 {
-	if (!ptr)
-	{
-		Node<State *> *node;
-
-		float num = 0;
+	Vertex *my_child = children[child - 1];
+	CPD *cpd = my_child->table;
 
-		for (int i = 1, j = 1; i <= my_child->states->getSize(); i++)
-		{
-			j = 1;
-	
-			num += ((my_child->p(i, combo)) * (my_child->lambda_evidence[i - 1]) );
-			node = combo->getHead();
-			while (node)
-			{
-				if (node->data != my_state)
-				{
-					num *= my_child->pi_messages[j - 1][node->data->id - 1];
-				}	
-				node = node->next;
-				j++;
+	for (int k = my_child->parents.getSize() - 1; k >= 0; k--)
+	{
+		my_child->factors[k] = my_child->pi_messages[k].begin();
+	}
 
-			}
-		}
+	Arena &arena = getArena();
+	arena.enter();
+	size_t mark = arena.mark();
+	float *scratch = arena.allocate<float>(cpd->scratchSize());
 
-		sum += num;
+	if (cpd->getKind() == CPD_NOISY_MAX)
+	{
+		NoisyTable<float> noisy = { cpd->getParameters() };
+		Kernel::lambdaMessage(noisy, cpd->getWidth(), cpd->getRadices(), my_child->parents.getSize(), child_slots[child - 1],
+			my_child->factors.begin(), my_child->lambda_evidence.begin(), scratch, message);
+	}
+	else if (cpd->getKind() == CPD_TREE)
+	{
+		Kernel::lambdaMessage(cpd->getTree(), cpd->getWidth(), cpd->getRadices(), my_child->parents.getSize(), child_slots[child - 1],
+			my_child->factors.begin(), my_child->lambda_evidence.begin(), scratch, message);
 	}
 	else
 	{
-		Node<State> *p = ptr->data->getStates()->getHead();
-		if (ptr->data == this)
-		{
-			combo->append(my_state);
-			lambdaMessage(ptr->next, combo, my_child, my_state, sum);
-			combo->removeLast();
-		}
-		else
-		{
-			while (p)
-			{
-				combo->append(&(p->data));
-				lambdaMessage(ptr->next, combo, my_child, my_state, sum);
-				combo->removeLast();
-				p = p->next;
-			}
-		}
+		Kernel::lambdaMessage(cpd->getTable(), cpd->getWidth(), cpd->getRadices(), my_child->parents.getSize(), child_slots[child - 1],
+			my_child->factors.begin(), my_child->lambda_evidence.begin(), scratch, message);
 	}
+
+	arena.rewind(mark);
+	arena.leave();
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
 
 /*
 please refer to the function
-void Vertex::lambdaMessage(Node<Vertex *> *ptr, LinkedList<State *> *combo, Vertex *my_child, State *my_state, float &sum)
+void Vertex::lambdaMessage(int child, float *message)
 
 @param	child	the pointer to the child node
 @param	state	the pointer to the state of the parent
@@ -1219,15 +1492,7 @@ void Vertex::lambdaMessage(Node<Vertex *> *ptr, LinkedList<State *> *combo, Vert
 */
 float Vertex::lambdaMessage(Vertex *child, State *state)
 {
-	float sum = 0;
-	LinkedList<State *> *combo = new LinkedList<State *>();
-
-	LinkedList<Vertex *> *siblings = new LinkedList<Vertex *>();
-	child->getParents(siblings);
-	Node<Vertex *> *ptr = siblings->getHead();
-
-	lambdaMessage(ptr, combo, child, state, sum);
-	return sum;
+	return lambdaMessage(childIndex(child) + 1, state);
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -1269,19 +1534,18 @@ float Vertex::lambdaMessage(Vertex *child, State *state)
 */
 float Vertex::lambdaMessage(int child, State *state)
 {
-	LinkedList<Vertex *> *children = new LinkedList<Vertex *>();
-	getChildren(children);
-	Node<Vertex *> *ptr = children->getHead();
-
-	if (child < 1 || child > children->getSize())
+	if (child < 1 || child > (int)children.getSize())
 		throw - 1;
 
-	while (--child)
-	{
-		ptr = ptr->next;
-	}
+	Arena &arena = getArena();
+	arena.enter();
+
+	float *message = arena.allocate<float>(states->getSize());
+	lambdaMessage(child, message);
+	float value = message[state->id - 1];
 
-	return lambdaMessage(ptr->data, state);
+	arena.leave();
+	return value;
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -1319,8 +1583,6 @@ float Vertex::lambdaEvidence(int state)
 		return 0;
 	}
 
-	LinkedList<Vertex *> *children = new LinkedList<Vertex *>();
-	getChildren(children);
 	float product = 1;
 
 	/*Node<Vertex *> *ptr = children->getHead();
@@ -1329,7 +1591,7 @@ float Vertex::lambdaEvidence(int state)
 	product *= lambdaMessage(ptr->data, state);
 	}*/
 
-	for (int i = children->getSize() - 1; i >= 0; i--)
+	for (int i = children.getSize() - 1; i >= 0; i--)
 	{
 		product *= lambda_messages[i][state - 1];
 	}
@@ -1381,13 +1643,7 @@ tells whether if the node has no parents
 */
 bool Vertex::isRoot()
 {
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
-	getParents(parents);
-
-	if (!(parents->getSize()))
-		return true;
-	else
-		return false;
+	return !parents.getSize();
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -1404,17 +1660,7 @@ bool Vertex::isObserved(int state)
 	if (state < 1 || state > getStates()->getSize())
 		throw - 1;
 
-	if (isObserved())
-	{
-		Node<State> *s = getStates()->getHead();
-		while (--state)
-		{
-			s = s->next;
-		}
-		return s->data.probability == 1;
-	}
-
-	return false;
+	return isObserved() && evidence == state;
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -1445,7 +1691,7 @@ void Vertex::posteriorProbabilities()
 	{
 		sum += lambda_evidence[i] * pi_evidence[i];
 	}
-	float Alpha = (float) 1.00 / sum;
+	float Alpha = sum > 0 ? (float) 1.00 / sum : 0;
 
 	Node<State> *state = getStates()->getHead();
 	int i = 0;
@@ -1460,192 +1706,1053 @@ void Vertex::posteriorProbabilities()
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
 
 /*
-initializes the vertex...
-sets the default values
+marks everything which depends on the evidence of this vertex as out of date, without computing
+anything : every message leading away from the vertex and the posteriors of the vertices they
+reach. the walk stops at messages which are stale already, so marking again after a change close
+by costs next to nothing. call it after setEvidence() or clearEvidence() on a propagated graph.
 */
-void Vertex::initialize()
+void Vertex::invalidate()
 {
-	flag = false;
-
-	LinkedList<Vertex *> *children = new LinkedList<Vertex *>();
-	getChildren(children);
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
-	getParents(parents);
-	Node<Vertex *> *ptr = parents->getHead();
-
-	lambda_evidence = Vector<float>(getStates()->getSize(), 1);
-	lambda_messages = Vector< Vector<float> >(children->getSize(), Vector<float>(getStates()->getSize(), 1));
-	pi_messages = Vector< Vector<float> >(parents->getSize());
+	lambda_dirty = posterior_dirty = true;
 
-	int i = 0;
-	while (ptr)
-	{
-		pi_messages[i++] = Vector<float>(ptr->data->getStates()->getSize(), 1);
-		ptr = ptr->next;
-	}
+	/*the vertices still to be walked from, each as the receiver of the message it was reached by*/
+	MessageStack stack(getArena());
+	stack.push(NULL, this);
 
-	if (!parents->getSize())
+	while (!stack.isEmpty())
 	{
+		Vertex *vertex = stack.getReceiver(), *source = stack.getSender();
+		stack.pop();
 
-		int arr[] = { 1 };
-		for (int i = states->getSize() - 1; i >= 0; i--)
+		for (int k = 0; k < (int)vertex->parents.getSize(); k++)
 		{
-			pi_evidence[i] = table->p(i + 1, arr);
+			Vertex *parent = vertex->parents[k];
+			if (parent != source && !parent->stale_lambda[vertex->parent_slots[k]])
+			{
+				parent->stale_lambda[vertex->parent_slots[k]] = 1;
+				parent->lambda_dirty = parent->posterior_dirty = true;
+				stack.push(vertex, parent);
+			}
 		}
 
-		pi_messages.clear();
+		for (int j = 0; j < (int)vertex->children.getSize(); j++)
+		{
+			Vertex *child = vertex->children[j];
+			if (child != source && !child->stale_pi[vertex->child_slots[j]])
+			{
+				child->stale_pi[vertex->child_slots[j]] = 1;
+				child->pi_dirty = child->posterior_dirty = true;
+				stack.push(vertex, child);
+			}
+		}
 	}
 }
 
 //---------------------------------------------------------------------------------------------------------------------------------------------------------
 
-Vertex::~Vertex()
+/*
+brings the posterior probabilities of the vertex (the probabilities of its states) up to date.
+only the stale messages on the way to the vertex are computed, each after the stale messages it
+depends on, with an explicit stack instead of recursion. nothing is done if nothing has changed.
+*/
+void Vertex::update()
 {
-	delete pointers;
-	delete states;
-	delete table;
-//	lambda_evidence.~Vector();
+	if (!posterior_dirty)
+		return;
 
-}
+	/*the messages still to be sent. a message is expanded (its own stale inputs
+	pushed above it) the first time it is on top, and sent the second time.*/
+	MessageStack messages(getArena());
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	for (int k = 0; k < (int)parents.getSize(); k++)
+	{
+		if (stale_pi[k])
+			messages.push(parents[k], this);
+	}
+	for (int j = 0; j < (int)children.getSize(); j++)
+	{
+		if (stale_lambda[j])
+			messages.push(children[j], this);
+	}
 
-/*
-class copy constructor
+	while (!messages.isEmpty())
+	{
+		Vertex *sender = messages.getSender(), *receiver = messages.getReceiver();
 
-@param	vertex		a pointer to a vertex to be copied.
+		if (messages.isExpanded())
+		{
+			messages.pop();
+			sender->send(receiver);
+			continue;
+		}
+		messages.expand();
 
-*/
-CPD::CPD(Vertex *vertex)
-{
-	/*copying the contents*/
-	this->vertex = vertex;
-	initialize();
+		for (int k = 0; k < (int)sender->parents.getSize(); k++)
+		{
+			if (sender->parents[k] != receiver && sender->stale_pi[k])
+				messages.push(sender->parents[k], sender);
+		}
+		for (int j = 0; j < (int)sender->children.getSize(); j++)
+		{
+			if (sender->children[j] != receiver && sender->stale_lambda[j])
+				messages.push(sender->children[j], sender);
+		}
+	}
+
+	if (pi_dirty)
+		piEvidence();
+	if (lambda_dirty)
+		lambdaEvidence();
+	posteriorProbabilities();
+	pi_dirty = lambda_dirty = posterior_dirty = false;
 }
 
-//--------------------------------------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
 
 /*
-sets the height of the table which
-will be equal to the product of all the combinations of its parents
+@param	state	the one-based index of a state
+@return			its posterior probability, brought up to date first
 */
-void CPD::setHeight()
+float Vertex::getPosterior(int state)
 {
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
-	vertex->getParents(parents);
-	Node<Vertex *> *ptr = parents->getHead();
-	int H = 1;
-	while (ptr)
+	if (state < 1 || state > states->getSize())
+		throw - 1;
+
+	update();
+
+	Node<State> *ptr = states->getHead();
+	while (--state)
 	{
-		H *= ptr->data->getStates()->getSize();
 		ptr = ptr->next;
 	}
-	height = H;
-}
-
-//--------------------------------------------------------------------------------------------------------------------------------------------------
-
-/*
-sets the width of the table
-considering the size of the vertex states.
-*/
-void CPD::setWidth()
-{
-	width = vertex->getStates()->getSize();
+	return ptr->data.probability;
 }
 
-//--------------------------------------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
 
 /*
-prompts the user to enter values for each entry in the table
+computes the message from this vertex to a neighbour, whose other inputs must be up to date,
+recomputing first the evidence vector the message is made from if it is stale
 
+@param	receiver	a parent or a child of the vertex
 */
-void CPD::setValues()
+void Vertex::send(Vertex *receiver)
 {
-	cout << "Enter the value for table :\n";
-	for (int i = 0; i < width; i++)
+	for (int j = 0; j < (int)children.getSize(); j++)
 	{
-		for (int j = 0; j < height; j++)
+		if (children[j] == receiver)
 		{
-			cout << "(" << i << " , " << j << ") : "; cin >> table[i][j];
+			if (pi_dirty)
+			{
+				piEvidence();
+				pi_dirty = false;
+			}
+			receiver->piMessage(child_slots[j] + 1);
+			receiver->stale_pi[child_slots[j]] = 0;
+			receiver->pi_dirty = receiver->posterior_dirty = true;
+			return;
 		}
 	}
-}
-
-//--------------------------------------------------------------------------------------------------------------------------------------------------
 
-void CPD::setValue(int i, int j, float k)
-{
-	this->table[i][j] = k;
-}
+	for (int k = 0; k < (int)parents.getSize(); k++)
+	{
+		if (parents[k] == receiver)
+		{
+			if (lambda_dirty)
+			{
+				lambdaEvidence();
+				lambda_dirty = false;
+			}
+			receiver->lambdaMessage(parent_slots[k] + 1);
+			receiver->stale_lambda[parent_slots[k]] = 0;
+			receiver->lambda_dirty = receiver->posterior_dirty = true;
+			return;
+		}
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+called by a Schedule once every message into the vertex has been computed and so have its
+evidence vectors : nothing is stale any more but the posterior, which is left for update()
+*/
+void Vertex::settle()
+{
+	for (int k = stale_pi.getSize() - 1; k >= 0; k--)
+	{
+		stale_pi[k] = 0;
+	}
+	for (int j = stale_lambda.getSize() - 1; j >= 0; j--)
+	{
+		stale_lambda[j] = 0;
+	}
+	pi_dirty = lambda_dirty = false;
+	posterior_dirty = true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+initializes the vertex...
+sets the default values
+*/
+void Vertex::initialize()
+{
+	flag = false;
+	evidence = 0;
+
+	lambda_evidence = Vector<float>(getStates()->getSize(), 1);
+	pi_evidence = Vector<float>(getStates()->getSize(), 1);
+	lambda_messages = Vector< Vector<float> >(children.getSize(), Vector<float>(getStates()->getSize(), 1));
+	pi_messages = Vector< Vector<float> >(parents.getSize());
+	stale_pi = Vector<char>(parents.getSize(), 0);
+	stale_lambda = Vector<char>(children.getSize(), 0);
+	pi_dirty = lambda_dirty = posterior_dirty = true;
+
+	for (int i = 0; i < (int)parents.getSize(); i++)
+	{
+		pi_messages[i] = Vector<float>(parents[i]->getStates()->getSize(), 1);
+	}
+
+	if (!parents.getSize())
+	{
+
+		int arr[] = { 1 };
+		for (int i = states->getSize() - 1; i >= 0; i--)
+		{
+			pi_evidence[i] = table->p(i + 1, arr);
+		}
+
+		pi_messages.clear();
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------------------------------
+
+Vertex::~Vertex()
+{
+	delete pointers;
+	delete states;
+	delete table;
+//	lambda_evidence.~Vector();
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*static variable initialization*/
+atomic<unsigned int> Schedule::count(0);
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+builds the schedule for the part of the graph connected to a vertex
+
+@param	start	the vertex the schedule starts from
+*/
+Schedule::Schedule(Vertex *start)
+{
+	initialize(start->getArena());
+	add(start, ++count);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+builds the schedule for every vertex of a graph, one tree after another
+
+@param	vertices	the vertices of the graph
+@param	arena		the arena of the graph
+*/
+Schedule::Schedule(LinkedList<Vertex *> *vertices, Arena &arena)
+{
+	unsigned int stamp = ++count;
+
+	initialize(arena);
+
+	for (Node<Vertex *> *ptr = vertices->getHead(); ptr; ptr = ptr->next)
+	{
+		if (ptr->data->stamp != stamp)
+			add(ptr->data, stamp);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+builds one schedule covering the trees of several vertices.
+each tree is scheduled once however many of the vertices it contains.
+
+@param	starts	the vertices
+@param	size	the number of vertices, at least 1. they are all in the same graph.
+*/
+Schedule::Schedule(Vertex **starts, int size)
+{
+	unsigned int stamp = ++count;
+
+	initialize(starts[0]->getArena());
+
+	for (int i = 0; i < size; i++)
+	{
+		if (starts[i]->stamp != stamp)
+			add(starts[i], stamp);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+starts an empty schedule
+
+@param	arena	the arena it draws from
+*/
+void Schedule::initialize(Arena &arena)
+{
+	this->arena = &arena;
+	arena.enter();
+	order = NULL;
+	links = NULL;
+	size = capacity = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+appends a vertex to the order. when the arrays are full they are moved
+to a block twice as large, the old block stays in the arena until it is reset.
+
+@param	vertex	the vertex
+@param	link	how the vertex was reached
+*/
+void Schedule::push(Vertex *vertex, int link)
+{
+	if (size == capacity)
+	{
+		capacity = capacity ? 2 * capacity : 64;
+
+		Vertex **new_order = arena->allocate<Vertex *>(capacity);
+		int *new_links = arena->allocate<int>(capacity);
+		for (int i = 0; i < size; i++)
+		{
+			new_order[i] = order[i];
+			new_links[i] = links[i];
+		}
+		order = new_order;
+		links = new_links;
+	}
+
+	order[size] = vertex;
+	links[size++] = link;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+appends the tree containing start to the order, breadth first
+
+@param	start	the first vertex of the tree
+@param	stamp	marks the vertices already in this schedule
+*/
+void Schedule::add(Vertex *start, unsigned int stamp)
+{
+	int head = size;
+
+	start->stamp = stamp;
+	push(start, 0);
+
+	while (head < size)
+	{
+		Vertex *vertex = order[head++];
+
+		for (int k = 0; k < (int)vertex->parents.getSize(); k++)
+		{
+			if (vertex->parents[k]->stamp != stamp)
+			{
+				vertex->parents[k]->stamp = stamp;
+				push(vertex->parents[k], -(vertex->parent_slots[k] + 1));
+			}
+		}
+
+		for (int j = 0; j < (int)vertex->children.getSize(); j++)
+		{
+			if (vertex->children[j]->stamp != stamp)
+			{
+				vertex->children[j]->stamp = stamp;
+				push(vertex->children[j], vertex->child_slots[j] + 1);
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of vertices in the schedule
+*/
+int Schedule::getSize()
+{
+	return size;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the upward sweep. walks the order backwards and lets every vertex
+send its message to the vertex it was reached from. by then all the
+other messages that vertex needs have already arrived.
+*/
+void Schedule::collect()
+{
+	for (int i = size - 1; i >= 0; i--)
+	{
+		Vertex *vertex = order[i];
+		int link = links[i];
+
+		if (link > 0)
+		{
+			vertex->lambdaEvidence();
+			vertex->parents[link - 1]->lambdaMessage(vertex->parent_slots[link - 1] + 1);
+		}
+		else if (link < 0)
+		{
+			vertex->piEvidence();
+			vertex->children[-link - 1]->piMessage(vertex->child_slots[-link - 1] + 1);
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the downward sweep. walks the order forwards; every vertex has all of its
+messages by the time it is reached, so it computes its evidence vectors
+and sends messages to all the neighbours after it. the posterior
+probabilities are left to Vertex::update(), for the vertices which are read.
+*/
+void Schedule::distribute()
+{
+	for (int i = 0; i < size; i++)
+	{
+		Vertex *vertex = order[i];
+		int link = links[i];
+
+		vertex->lambdaEvidence();
+		vertex->piEvidence();
+		vertex->settle();
+
+		for (int k = 0; k < (int)vertex->parents.getSize(); k++)
+		{
+			if (link != k + 1)
+				vertex->parents[k]->lambdaMessage(vertex->parent_slots[k] + 1);
+		}
+
+		for (int j = 0; j < (int)vertex->children.getSize(); j++)
+		{
+			if (link != -(j + 1))
+				vertex->children[j]->piMessage(vertex->child_slots[j] + 1);
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+propagates the current evidence through every vertex of the schedule
+*/
+void Schedule::run()
+{
+	collect();
+	distribute();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+Schedule::~Schedule()
+{
+	arena->leave();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+starts an empty stack
+
+@param	arena	the arena it draws from
+*/
+MessageStack::MessageStack(Arena &arena)
+{
+	this->arena = &arena;
+	arena.enter();
+	items = NULL;
+	size = capacity = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+puts a message on top, not expanded yet. when the stack is full it is moved
+to a block twice as large, the old block stays in the arena until it is reset.
+
+@param	sender		the vertex the message is from
+@param	receiver	the vertex it is sent to
+*/
+void MessageStack::push(Vertex *sender, Vertex *receiver)
+{
+	if (size == capacity)
+	{
+		capacity = capacity ? 2 * capacity : 64;
+
+		Message *new_items = arena->allocate<Message>(capacity);
+		for (int i = 0; i < size; i++)
+		{
+			new_items[i] = items[i];
+		}
+		items = new_items;
+	}
+
+	items[size].sender = sender;
+	items[size].receiver = receiver;
+	items[size++].expanded = false;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+removes the message on top
+*/
+void MessageStack::pop()
+{
+	size--;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+bool MessageStack::isEmpty()
+{
+	return size == 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the sender of the message on top
+*/
+Vertex * MessageStack::getSender()
+{
+	return items[size - 1].sender;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the receiver of the message on top
+*/
+Vertex * MessageStack::getReceiver()
+{
+	return items[size - 1].receiver;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		whether expand() was called on the message on top
+*/
+bool MessageStack::isExpanded()
+{
+	return items[size - 1].expanded;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+marks the message on top as expanded
+*/
+void MessageStack::expand()
+{
+	items[size - 1].expanded = true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+MessageStack::~MessageStack()
+{
+	arena->leave();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+class copy constructor
+
+@param	vertex		a pointer to a vertex to be copied.
+
+*/
+CPD::CPD(Vertex *vertex)
+{
+	/*copying the contents*/
+	this->vertex = vertex;
+	table = parameters = leaves = NULL;
+	radices = strides = tree = NULL;
+	num_of_parents = tree_size = num_of_leaves = 0;
+	kind = CPD_TABLE;
+	initialize();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+allocates a buffer of floats whose first entry lies on a CPD_ALIGNMENT boundary.
+the pointer returned by new is stored just before the aligned block so that
+release() can find it again.
+
+@param	size	the number of floats required
+
+@return		the aligned buffer
+*/
+float * CPD::allocate(int size)
+{
+	char *raw = new char[size * sizeof(float) + CPD_ALIGNMENT + sizeof(char *)];
+	size_t address = (size_t)(raw + sizeof(char *));
+	address = (address + CPD_ALIGNMENT - 1) & ~((size_t)CPD_ALIGNMENT - 1);
+
+	((char **)address)[-1] = raw;
+	return (float *)address;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+frees a buffer given by allocate()
+
+@param	buffer	the aligned buffer (may be NULL)
+*/
+void CPD::release(float *buffer)
+{
+	if (buffer)
+		delete[] ((char **)buffer)[-1];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+computes the radix and the stride of every parent.
+the first parent is the most significant digit, the last parent changes fastest,
+which is the same order in which the combinations are generated everywhere else.
+a noisy-MAX CPD has no rows, its strides are left at 0.
+*/
+void CPD::setStrides()
+{
+	View<Vertex *> parents = vertex->getParents();
+
+	delete[] radices;
+	delete[] strides;
+	num_of_parents = parents.getSize();
+	radices = new int[num_of_parents + 1];
+	strides = new int[num_of_parents + 1];
+
+	for (int k = 0; k < num_of_parents; k++)
+	{
+		radices[k] = parents[k]->getStates()->getSize();
+	}
+
+	int stride = kind == CPD_TABLE;
+	for (int k = num_of_parents - 1; k >= 0; k--)
+	{
+		strides[k] = stride;
+		stride *= radices[k];
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+sets the height of the table which
+will be equal to the product of all the combinations of its parents
+(0 for a noisy-MAX CPD, which has no table)
+*/
+void CPD::setHeight()
+{
+	int H = kind == CPD_TABLE;
+	for (int k = 0; k < num_of_parents; k++)
+	{
+		H *= radices[k];
+	}
+	height = H;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+sets the width of the table
+considering the size of the vertex states.
+*/
+void CPD::setWidth()
+{
+	width = vertex->getStates()->getSize();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+prompts the user to enter values for each entry in the table
+
+*/
+void CPD::setValues()
+{
+	if (kind != CPD_TABLE)
+		throw - 1;
+
+	cout << "Enter the value for table :\n";
+	for (int i = 0; i < width; i++)
+	{
+		for (int j = 0; j < height; j++)
+		{
+			cout << "(" << i << " , " << j << ") : "; cin >> table[j * width + i];
+		}
+	}
+	vertex->touch();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+void CPD::setValue(int i, int j, float k)
+{
+	if (kind != CPD_TABLE)
+		throw - 1;
+
+	this->table[j * width + i] = k;
+	vertex->touch();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of rows i.e. the number of parent combinations, 0 for a noisy-MAX CPD
+*/
+int CPD::getHeight()
+{
+	return height;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of columns i.e. the number of states of the vertex
+*/
+int CPD::getWidth()
+{
+	return width;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+gives the flat table, row by row.
+entry (state, row) is at getTable()[row * getWidth() + state]
+
+@return		pointer to the first entry of the table, NULL for a noisy-MAX CPD
+*/
+float * CPD::getTable()
+{
+	return table;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of states of every parent, in the order of the rows
+*/
+int * CPD::getRadices()
+{
+	return radices;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		CPD_TABLE if the CPD is a table, CPD_NOISY_MAX if it is given by the parameters
+			set with setNoisyMax() or setNoisyOr(), CPD_TREE if it is the tree set with setTree()
+*/
+int CPD::getKind()
+{
+	return kind;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the parameters of a noisy-MAX CPD, laid out as NoisyTable::parameters
+			(cumulative, with a row of 1s for the first state of every parent), NULL for a table
+*/
+float * CPD::getParameters()
+{
+	return parameters;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the tree of a tree CPD and its leaves, laid out as the kernels read them
+			(see TreeTable), an empty tree for any other kind
+*/
+TreeTable<float> CPD::getTree()
+{
+	TreeTable<float> table = { tree, tree_size, leaves, num_of_leaves };
+	return table;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of floats of scratch the kernels need for this CPD, which the vertex takes from its arena :
+			one per entry of a table, two rows for a noisy-MAX CPD, and for a tree one per parent
+			and one per entry of the tree and per leaf for every state of the widest parent
+*/
+int CPD::scratchSize()
+{
+	if (kind == CPD_NOISY_MAX)
+		return 2 * width;
+	if (kind == CPD_TABLE)
+		return width * height;
+
+	int widest = 1;
+	for (int k = 0; k < num_of_parents; k++)
+	{
+		widest = radices[k] > widest ? radices[k] : widest;
+	}
+	return num_of_parents + (tree_size + num_of_leaves) * widest;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+switches the CPD to another kind, freeing what the former one kept and fixing the dimensions.
+the caller fills in the new kind.
+
+@param	kind	CPD_TABLE, CPD_NOISY_MAX or CPD_TREE
+*/
+void CPD::setKind(int kind)
+{
+	if (kind != CPD_TABLE)
+	{
+		release(table);
+		table = NULL;
+	}
+	if (kind != CPD_NOISY_MAX)
+	{
+		delete[] parameters;
+		parameters = NULL;
+	}
+	if (kind != CPD_TREE)
+	{
+		delete[] tree;
+		delete[] leaves;
+		tree = NULL;
+		leaves = NULL;
+		tree_size = num_of_leaves = 0;
+	}
+
+	this->kind = kind;
+	setStrides();
+	setHeight();
+}
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 
 /*
 initializes the table, sets its dimensions
-and equals distributes all probabilities
+and equals distributes all probabilities.
+a noisy-MAX CPD stays one : every parent is given no effect and the leak is kept,
+so the table of a vertex made noisy before its parents are connected is never allocated.
+a tree CPD stays one as well, made of a single uniform leaf.
 */
 void CPD::initialize()
 {
 	width = vertex->getStates()->getSize();
+	setStrides();
 	setHeight();
-	table = Vector< Vector<float> >(width);
-	for (int i = 0; i < width; i++)
-		table[i] = Vector<float>(height);
 
+	release(table);
+	table = NULL;
+
+	if (kind == CPD_NOISY_MAX)
+	{
+		int size = width;
+		for (int k = 0; k < num_of_parents; k++)
+		{
+			size += radices[k] * width;
+		}
+
+		float *leak = parameters;
+		parameters = new float[size];
+		for (int i = 0; i < size; i++)
+		{
+			parameters[i] = i < width && leak ? leak[i] : 1.00f;
+		}
+		delete[] leak;
+
+		vertex->touch();
+		return;
+	}
+
+	if (kind == CPD_TREE)
+	{
+		delete[] tree;
+		delete[] leaves;
+		tree = new int[1];
+		leaves = new float[width];
+		tree[0] = -1;
+		tree_size = num_of_leaves = 1;
+
+		for (int x = 0; x < width; x++)
+		{
+			leaves[x] = (float) 1.00f / width;
+		}
+
+		vertex->touch();
+		return;
+	}
+
+	table = allocate(width * height);
+	vertex->touch();
+
+	for (int j = width * height - 1; j >= 0; j--)
+	{
+		table[j] = (float) 1.00f / width;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+displays all the entries of the table in a tradional fashion.
+*/
+void CPD::display()
+{
 	for (int i = 0; i < width; i++)
 	{
 		for (int j = 0; j < height; j++)
 		{
-			table[i][j] = (float) 1.00f / width;
+			cout << table[j * width + i] << "\t";
 		}
+		cout << endl;
 	}
+}
 
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
-	vertex->getParents(parents);
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+displays a rows of the table given its column index
+*/
+void CPD::displayRow(int i)
+{
+	for (int j = 0; j < width; j++)
+	{
+		cout << setprecision(2) << table[i * width + j] << "\t";
+	}
+	cout << endl;
 }
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 
 /*
-displays all the entries of the table in a tradional fashion.
+displays one row of the parameters of a noisy-MAX CPD as the probabilities of the states
+
+@param	effect	width cumulative probabilities
 */
-void CPD::display()
+void CPD::displayEffect(const float *effect)
 {
-	for (int i = 0; i < width; i++)
+	for (int x = 0; x < width; x++)
 	{
-		for (int j = 0; j < height; j++)
-		{
-			cout << table[i][j] << "\t";
-		}
-		cout << endl;
+		cout << setprecision(2) << effect[x] - (x ? effect[x - 1] : 0) << "\t";
 	}
+	cout << endl;
 }
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 
 /*
-displays a rows of the table given its column index
+displays the leaves of a tree CPD below one of its nodes, each after the context leading to it
+
+@param	position	the node, in the layout of TreeTable::nodes
+@param	context		the tests on the way down to the node
 */
-void CPD::displayRow(int i)
+void CPD::displayContext(int position, string context)
 {
-	for (int j = 0; j < width; j++)
+	int k = tree[position];
+	if (k < 0)
+	{
+		cout << (context.empty() ? "*" : context) << "\t";
+		for (int x = 0; x < width; x++)
+		{
+			cout << setprecision(2) << leaves[(-1 - k) * width + x] << "\t";
+		}
+		cout << endl;
+		return;
+	}
+
+	Vertex *parent = vertex->getParents()[k];
+	Node<State> *ptr = parent->getStates()->getHead();
+	for (int u = 0; u < radices[k]; u++, ptr = ptr->next)
 	{
-		cout << setprecision(2) << table[j][i] << "\t";
+		displayContext(tree[position + 1 + u], context + (context.empty() ? "" : ",") + parent->getName() + "=" + ptr->data.name);
 	}
-	cout << endl;
 }
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 
 /*
 displays the table in a formal fashion
-with the name of the Vertex and its parent states.*/
+with the name of the Vertex and its parent states.
+a noisy-MAX CPD is shown as its leak and one row for every state but the first of every parent,
+a tree CPD as one row for every context.*/
 void CPD::displayTable()
 {
+	if (kind == CPD_NOISY_MAX)
+	{
+		cout << "noisy-MAX CPT for vertex :\t" << vertex->getName() << endl << "cause\tstate\t";
+		for (Node<State> *ptr = vertex->getStates()->getHead(); ptr; ptr = ptr->next)
+		{
+			cout << ptr->data.name << "\t";
+		}
+		cout << endl << "leak\t\t";
+		displayEffect(parameters);
+
+		View<Vertex *> parents = vertex->getParents();
+		const float *effect = parameters + width;
+		for (int k = 0; k < num_of_parents; k++)
+		{
+			Node<State> *ptr = parents[k]->getStates()->getHead();
+			for (int u = 0; u < radices[k]; u++, effect += width, ptr = ptr->next)
+			{
+				if (!u)
+					continue;
+
+				cout << parents[k]->getName() << "\t" << ptr->data.name << "\t";
+				displayEffect(effect);
+			}
+		}
+		return;
+	}
+
+	if (kind == CPD_TREE)
+	{
+		cout << "tree CPT for vertex :\t" << vertex->getName() << endl << "context\t";
+		for (Node<State> *ptr = vertex->getStates()->getHead(); ptr; ptr = ptr->next)
+		{
+			cout << ptr->data.name << "\t";
+		}
+		cout << endl;
+		displayContext(0, "");
+		return;
+	}
+
 	cout << "CPT for vertex :\t" << vertex->getName() << endl;
 
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
+	LinkedList<Vertex *> parents_list, *parents = &parents_list;
 	vertex->getParents(parents);
 	Node<Vertex *> *p = parents->getHead();
 
@@ -1729,6 +2836,8 @@ void CPD::updateTable()
 
 /*
 a function which calculates what row the given States are in, in the table.
+the states are read as the digits of a mixed-radix number, so no
+combinations have to be generated.
 
 @param	S		a pointer to a linked list containg State pointer as data.
 (given by user)
@@ -1737,13 +2846,12 @@ a function which calculates what row the given States are in, in the table.
 */
 int CPD::row(LinkedList<State *> *S)
 {
-	bool flag = true;
-	int row = 0;
-
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
-	vertex->getParents(parents);
+	int row = 0, k = 0;
 
-	generateStates(parents->getHead(), row, &LinkedList<State *>(), S, flag);
+	for (Node<State *> *s = S->getHead(); s && k < num_of_parents; s = s->next)
+	{
+		row += (s->data->id - 1) * strides[k++];
+	}
 
 	return row;
 }
@@ -1751,35 +2859,25 @@ int CPD::row(LinkedList<State *> *S)
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 
 /*
-a recursive function which generates the combinations from the parent states
+a function which calculates what row the given parent states are in, in the table.
 
-@param	ptr		pointer to node containing vertex pointer as data type. generally contains the parent linked list.
-@param	row		a int passed by reference to count the levels of recursion
-@param	combo	a pointer to a linked list populated with the combinations of the parent sates
-@param	S		a pointer to a linked list given by the user to check if it is equal to the combo states
+@param	combo	an array of one-based indices of the parents' states.
+
+@return			the zero-based row containing combo.
 */
-void CPD::generateStates(Node<Vertex *> *ptr, int &row, LinkedList<State *> *combo, LinkedList<State *> *S, bool &flag)
+int CPD::row(int *combo)
 {
-	if (!ptr)
-	{
-		if ((!(*combo == *S)) && flag)
-		{
-			row++;
-		}
-		else
-			flag = false;
-	}
-	else
+	int row = 0;
+
+	for (int k = 0; k < num_of_parents; k++)
 	{
-		Node<State> *p = ptr->data->getStates()->getHead();
-		while (p)
-		{
-			combo->append(&(p->data));
-			generateStates(ptr->next, row, combo, S, flag);
-			combo->removeLast();
-			p = p->next;
-		}
+		if (combo[k] < 1 || combo[k] > radices[k])
+			throw - 5;
+
+		row += (combo[k] - 1) * strides[k];
 	}
+
+	return row;
 }
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -1811,46 +2909,81 @@ int CPD::column(State * S)
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 
 /*
-calculates the probability given its indices from the table.
+the leaf a tree CPD reaches for a combination of the parents
 
-@param	n		one-based row number
-@param	combo	an array of indices of the parents' states.
+@param	combo	an array of one-based indices of the parents' states.
 
-@return		the probability of the state at nth row and combo's column
+@return		the first of the width probabilities of the leaf
 */
-float CPD::p(int n, int *combo)
+const float * CPD::leaf(const int *combo)
 {
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
-	vertex->getParents(parents);
-	Node<Vertex *> *ptr = parents->getHead();
-	LinkedList<State *> *s = new LinkedList<State *>();
+	for (int k = 0; k < num_of_parents; k++)
+	{
+		if (combo[k] < 1 || combo[k] > radices[k])
+			throw - 5;
+	}
 
-	Node<State> *node;
-	int i = 0, j = 0, num_states;
-	while (ptr)
+	int position = 0;
+	while (tree[position] >= 0)
 	{
-		node = ptr->data->getStates()->getHead();
-		num_states = ptr->data->getStates()->getSize();
+		position = tree[position + combo[tree[position]]];
+	}
+	return leaves + (-1 - tree[position]) * width;
+}
 
-		while (combo[i] != j + 1 && combo[i] <= num_states)
-		{
-			node = node->next;
-			j++;
-		}
+//--------------------------------------------------------------------------------------------------------------------------------------------------
 
-		if (combo[i] == j + 1 && combo[i] <= num_states)
-		{
-			j = 0;
-			s->append(&node->data);
-		}
-		else
+/*
+P(X <= x | combo) of a noisy-MAX CPD : the leak times the effect of every parent
+
+@param	x		a zero-based state of the vertex, below 0 for the probability 0
+@param	combo	an array of one-based indices of the parents' states.
+
+@return		the cumulative probability
+*/
+float CPD::cumulative(int x, const int *combo)
+{
+	if (x < 0)
+		return 0;
+
+	float value = parameters[x];
+	const float *effect = parameters + width;
+
+	for (int k = 0; k < num_of_parents; k++)
+	{
+		if (combo[k] < 1 || combo[k] > radices[k])
 			throw - 5;
 
-		i++;
-		ptr = ptr->next;
+		value *= effect[(combo[k] - 1) * width + x];
+		effect += radices[k] * width;
 	}
 
-	return table[n - 1][row(s)];
+	return value;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+calculates the probability given its indices from the table.
+a noisy-MAX CPD works it out from its parameters instead, in time linear in the parents,
+and a tree CPD reads it from the leaf the parents lead to.
+
+@param	n		one-based row number
+@param	combo	an array of indices of the parents' states.
+
+@return		the probability of the state at nth row and combo's column
+*/
+float CPD::p(int n, int *combo)
+{
+	if (kind == CPD_NOISY_MAX)
+	{
+		float value = cumulative(n - 1, combo) - cumulative(n - 2, combo);
+		return value > 0 ? value : 0;
+	}
+	if (kind == CPD_TREE)
+		return leaf(combo)[n - 1];
+
+	return table[row(combo) * width + n - 1];
 }
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -1865,9 +2998,19 @@ calculates the prbability of the given address
 */
 float CPD::p(int n, LinkedList<State *> *combo)
 {
-	int NUM = row(combo);
-	float num = table[n - 1][NUM];
-	return num;
+	if (kind != CPD_TABLE)
+	{
+		Vector<int> digits(num_of_parents, 1);
+		int k = 0;
+
+		for (Node<State *> *s = combo->getHead(); s && k < num_of_parents; s = s->next)
+		{
+			digits[k++] = s->data->id;
+		}
+		return p(n, digits.begin());
+	}
+
+	return table[row(combo) * width + n - 1];
 }
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -1882,9 +3025,12 @@ void CPD::reset(Node<Vertex *> *ptr, LinkedList<State *> *combo)
 */
 void CPD::resetTable()
 {
+	if (kind != CPD_TABLE)
+		throw - 1;
+
 	cout << "Reset CPT for vertex :\t" << vertex->getName() << endl;
 
-	LinkedList<Vertex *> *parents = new LinkedList<Vertex *>();
+	LinkedList<Vertex *> parents_list, *parents = &parents_list;
 	vertex->getParents(parents);
 	Node<Vertex *> *p = parents->getHead();
 
@@ -1911,7 +3057,7 @@ void CPD::resetTable()
 		ptr = vertex->getStates()->getHead();
 		while (ptr)
 		{
-			ptr->data.probability = table[i][0];
+			ptr->data.probability = table[i];
 			i++;
 			ptr = ptr->next;
 		}
@@ -1922,7 +3068,335 @@ void CPD::resetTable()
 
 void CPD::resetTable(CPD* new_table)
 {
-	table = new_table->table;
+	if (kind != CPD_TABLE || new_table->kind != CPD_TABLE)
+		throw - 1;
+
+	if (width * height != new_table->width * new_table->height)
+	{
+		release(table);
+		table = allocate(new_table->width * new_table->height);
+	}
+
+	width = new_table->width;
+	height = new_table->height;
+	vertex->touch();
+	for (int j = width * height - 1; j >= 0; j--)
+	{
+		table[j] = new_table->table[j];
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+fills a table from values laid out as the table itself, checking them on the way.
+every entry has to be finite and not negative, and every row has to sum to 1
+(to CPD_TOLERANCE) unless it is normalized, in which case its sum only has to be positive.
+
+@param	target		the table to be filled, may be values itself
+@param	values		height * width values
+@param	normalize	true to scale every row so that it sums to 1
+
+@return		false if the values are not a valid table, target is then left half filled
+*/
+bool CPD::fill(float *target, const float *values, bool normalize)
+{
+	int size = height * width;
+	if (!Kernel::isNonNegative(values, size))
+		return false;
+
+	for (int j = 0; j < size; j += width)
+	{
+		float sum = Kernel::sum(values + j, width);
+
+		if (normalize)
+		{
+			if (!(sum > 0))
+				return false;
+			Kernel::scale(target + j, values + j, 1.00f / sum, width);
+		}
+		else if (fabs(sum - 1.00f) > CPD_TOLERANCE)
+			return false;
+	}
+
+	if (!normalize && target != values)
+		memcpy(target, values, size * sizeof(float));
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+copies a whole table at once, instead of one setValue() per entry.
+the values are laid out parent-major, like getTable() : one row per combination of the
+parents (the first parent changing slowest, the last fastest) and the states of the vertex
+contiguous within a row, i.e. entry (state, row) is values[row * width + state].
+nothing is propagated, call Graph::initialize() once every table is set.
+
+@param	values		getHeight() * getWidth() values
+@param	size		the number of values, throws -1 if it is not the size of the table
+					or if the values are not valid (see fill()). the table is then left as it was.
+					a noisy-MAX CPD has no table and throws -1 too.
+@param	normalize	true to scale every row so that it sums to 1
+*/
+void CPD::setTable(const float *values, int size, bool normalize)
+{
+	if (kind != CPD_TABLE || size != height * width)
+		throw - 1;
+
+	float *buffer = allocate(size);
+	if (!fill(buffer, values, normalize))
+	{
+		release(buffer);
+		throw - 1;
+	}
+
+	release(table);
+	table = buffer;
+	vertex->touch();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+like setTable(), but takes the buffer itself instead of copying it : the values are checked
+(and normalized) in place and the buffer becomes the table. this is the way to fill a very
+large table, the values are written once by the caller and never copied.
+
+@param	values		a buffer given by CPD::allocate(), laid out as for setTable().
+					the CPD owns it from then on and frees it with the table.
+@param	size		the number of values, throws -1 if it is not the size of the table
+					or if the values are not valid. the buffer is then still the caller's,
+					and may have been partly normalized.
+@param	normalize	true to scale every row so that it sums to 1
+*/
+void CPD::adoptTable(float *values, int size, bool normalize)
+{
+	if (kind != CPD_TABLE || size != height * width || !values || !fill(values, values, normalize))
+		throw - 1;
+
+	if (values != table)
+		release(table);
+	table = values;
+	vertex->touch();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+turns a row of probabilities into the cumulative form the noisy-MAX kernels read,
+scaled to end on exactly 1
+
+@param	target	the result, width entries
+@param	row		width probabilities, NULL for the first state for sure (every entry 1)
+@param	width	the number of states
+*/
+void CPD::accumulate(float *target, const float *row, int width)
+{
+	float sum = 0;
+
+	for (int x = 0; x < width; x++)
+	{
+		sum += row ? row[x] : (float)!x;
+		target[x] = sum;
+	}
+	for (int x = 0; x < width; x++)
+	{
+		target[x] /= sum;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+makes the CPD a noisy-MAX one : every parent in a state u other than its first (absent) one
+causes a state of the vertex on its own, drawn from effect(u), and the vertex takes the highest
+state caused by any parent or by the leak. the states of the vertex are ordered from absent to
+most severe. the table is freed and only the parameters are kept, so a vertex with many parents
+costs memory and message time linear in its parents. a vertex made noisy before its parents are
+connected never allocates a table at all, new parents then start with no effect (see initialize()).
+nothing is propagated, call Graph::initialize() once every CPD is set.
+
+@param	effects		for every parent in turn, one row of getWidth() probabilities for every state of
+					the parent but the first : the distribution of the vertex given that state of the
+					parent alone, without the leak
+@param	size		the number of effects, throws -1 if it does not match the parents, if a value is
+					negative or a row does not sum to 1 (to CPD_TOLERANCE). the CPD is then left as it was.
+@param	leak		getWidth() probabilities, the distribution of the vertex when every parent is absent.
+					NULL for none, the vertex is then absent for sure.
+*/
+void CPD::setNoisyMax(const float *effects, int size, const float *leak)
+{
+	int rows = 0, total = width;
+	for (int k = 0; k < num_of_parents; k++)
+	{
+		rows += radices[k] - 1;
+		total += radices[k] * width;
+	}
+
+	if (size != rows * width || (size && !effects) || !Kernel::isNonNegative(effects, size)
+		|| (leak && (!Kernel::isNonNegative(leak, width) || fabs(Kernel::sum(leak, width) - 1.00f) > CPD_TOLERANCE)))
+		throw - 1;
+
+	for (int j = 0; j < size; j += width)
+	{
+		if (fabs(Kernel::sum(effects + j, width) - 1.00f) > CPD_TOLERANCE)
+			throw - 1;
+	}
+
+	float *buffer = new float[total], *target = buffer + width;
+	accumulate(buffer, leak, width);
+	for (int k = 0; k < num_of_parents; k++)
+	{
+		accumulate(target, NULL, width);
+		target += width;
+
+		for (int u = 1; u < radices[k]; u++, target += width, effects += width)
+		{
+			accumulate(target, effects, width);
+		}
+	}
+
+	setKind(CPD_NOISY_MAX);
+	delete[] parameters;
+	parameters = buffer;
+	vertex->touch();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+makes the CPD a noisy-OR one, the noisy-MAX CPD of a binary vertex with binary parents :
+the second state of a parent turns the vertex to its second state with a probability
+of its own, and the vertex is in its first state only if no parent nor the leak did so.
+
+@param	probabilities	for every parent, the probability it turns the vertex on by itself
+@param	size			the number of probabilities, throws -1 if it is not the number of parents,
+						if the vertex or a parent is not binary or if a probability is not in [0, 1]
+@param	leak			the probability the vertex is on when every parent is off
+*/
+void CPD::setNoisyOr(const float *probabilities, int size, float leak)
+{
+	if (width != 2 || size != num_of_parents || !(leak >= 0 && leak <= 1))
+		throw - 1;
+
+	Vector<float> effects(2 * size, 0);
+	for (int k = 0; k < size; k++)
+	{
+		if (radices[k] != 2 || !(probabilities[k] >= 0 && probabilities[k] <= 1))
+			throw - 1;
+
+		effects[2 * k] = 1.00f - probabilities[k];
+		effects[2 * k + 1] = probabilities[k];
+	}
+
+	float noise[] = { 1.00f - leak, leak };
+	setNoisyMax(effects.begin(), 2 * size, noise);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+copies one node of a tree given to setTree(), and the subtrees below it, into the layout of
+TreeTable::nodes : the children of a node are given their positions once they are copied.
+
+@param	nodes		the tree as given to setTree()
+@param	size		the number of entries of nodes
+@param	position	the entry of nodes the node starts at, moved past its subtrees
+@param	output		the copy, the node is appended to it
+@param	tested		1 for every parent tested on the way down to the node
+@param	count		the number of leaves
+@return				the position of the node in output, throws -1 if the tree is not valid
+*/
+int CPD::parseTree(const int *nodes, int size, int &position, Vector<int> &output, Vector<char> &tested, int count)
+{
+	if (position >= size)
+		throw - 1;
+
+	int k = nodes[position++], at = output.getSize();
+	if (k < 0)
+	{
+		if (-1 - k >= count)
+			throw - 1;
+
+		output.pushBack(k);
+		return at;
+	}
+
+	if (k >= num_of_parents || tested[k])
+		throw - 1;
+
+	output.pushBack(k);
+	for (int u = 0; u < radices[k]; u++)
+	{
+		output.pushBack(0);
+	}
+
+	tested[k] = 1;
+	for (int u = 0; u < radices[k]; u++)
+	{
+		int child = parseTree(nodes, size, position, output, tested, count);
+		output[at + 1 + u] = child;
+	}
+	tested[k] = 0;
+
+	return at;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+makes the CPD a context-specific one : a decision tree over the parents whose every leaf holds
+the distribution of the vertex in the contexts which end in it. a leaf may end any number of
+contexts, so rows which are the same across a block of parent combinations are kept once, and
+the messages go over the contexts instead of the combinations (see Kernel::piEvidence()).
+a vertex made a tree before its parents are connected never allocates a table at all.
+nothing is propagated, call Graph::initialize() once every CPD is set.
+
+@param	nodes		the tree in preorder : a node testing a parent is the zero-based index of the
+					parent followed by the subtrees of its states in order, a leaf is -1 - l for
+					row l of values. a parent may be tested only once on the way to any leaf.
+@param	size		the number of entries of nodes, throws -1 if they are not exactly one tree
+@param	values		count rows of getWidth() probabilities, the leaves
+@param	count		the number of leaves, throws -1 if their values are not valid (see fill()).
+					the CPD is then left as it was.
+@param	normalize	true to scale every leaf so that it sums to 1
+*/
+void CPD::setTree(const int *nodes, int size, const float *values, int count, bool normalize)
+{
+	if (!nodes || size < 1 || !values || count < 1 || !Kernel::isNonNegative(values, count * width))
+		throw - 1;
+
+	Vector<int> output;
+	Vector<char> tested(num_of_parents, 0);
+	int position = 0;
+
+	parseTree(nodes, size, position, output, tested, count);
+	if (position != size)
+		throw - 1;
+
+	float *buffer = new float[count * width];
+	for (int j = 0; j < count * width; j += width)
+	{
+		float sum = Kernel::sum(values + j, width);
+
+		if (normalize ? !(sum > 0) : fabs(sum - 1.00f) > CPD_TOLERANCE)
+		{
+			delete[] buffer;
+			throw - 1;
+		}
+		Kernel::scale(buffer + j, values + j, normalize ? 1.00f / sum : 1.00f, width);
+	}
+
+	setKind(CPD_TREE);
+	delete[] tree;
+	delete[] leaves;
+	tree_size = output.getSize();
+	tree = new int[tree_size];
+	memcpy(tree, output.begin(), tree_size * sizeof(int));
+	leaves = buffer;
+	num_of_leaves = count;
+	vertex->touch();
 }
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -1947,7 +3421,7 @@ void CPD::reset(Node<Vertex *> *ptr, LinkedList<State *> *combo)
 		int j = row(combo);
 		for (int i = 0; i < vertex->getStates()->getSize(); i++)
 		{
-			cin >> table[i][j];
+			cin >> table[j * width + i];
 		}
 		cout << endl;
 	}
@@ -1966,7 +3440,15 @@ void CPD::reset(Node<Vertex *> *ptr, LinkedList<State *> *combo)
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 
-CPD::~CPD(){}
+CPD::~CPD()
+{
+	release(table);
+	delete[] parameters;
+	delete[] tree;
+	delete[] leaves;
+	delete[] radices;
+	delete[] strides;
+}
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
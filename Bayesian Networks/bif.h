@@ -0,0 +1,1227 @@
+#ifndef BIF_H
+#define BIF_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <climits>
+#include <chrono>
+#include <fstream>
+#include <unordered_map>
+#include "vector.h"
+#include "graph.h"
+#include "pool.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*the bytes read from the file at a time*/
+#define BIF_CHUNK (1 << 20)
+
+/*the bytes of probability blocks (their text and their values) which may be waiting for
+the pool at once. once there are more the reader waits for them before going on, so the
+memory used stays bounded however large the file is.*/
+#define BIF_WINDOW (64 << 20)
+
+/*one probability block of the file. its text is turned into values on the pool, the values
+are then copied into the CPT of the child by the reading thread. everything a block needs is
+in the block itself, the outcomes of the variables are never changed once declared.*/
+struct BifBlock
+{
+	int child;
+
+	int height, width;//the rows and the columns of the CPT of the child
+
+	Vector< Vector<string> * > parents;//the outcomes of every parent, in the order given
+
+	string text;//the body of a BIF block or the TABLE of an XMLBIF one
+
+	bool xml;
+
+	float *values;//filled by the pool from CPD::allocate(), then handed over to the CPT of the child
+
+	bool failed;
+
+	~BifBlock();
+};
+
+/*reads a network from a BIF (the JavaBayes interchange format) or XMLBIF file in one pass.
+the file is streamed through a small buffer, a variable becomes a Vertex as soon as it is
+declared and a probability block is handed to a ThreadPool as soon as it has been read, so
+the tables of the network are parsed in parallel while the rest of the file is still being
+read. only the blocks in flight are kept in memory (see BIF_WINDOW).
+
+the reader owns the Graph and its vertices, they live as long as the reader does.
+any syntax error, unknown variable or outcome, row not summing to 1, variable given two
+probability blocks, or parent joining two variables which are joined already (the network must be
+a polytree) throws -9. a file that cannot be opened throws -8.*/
+class BifReader
+{
+private:
+
+	ifstream in;
+
+	char *buffer;
+
+	size_t size, position;//the bytes in the buffer and the next one to be read
+
+	Graph *graph;
+
+	Vector<Vertex *> vertices;
+
+	Vector< Vector<string> * > outcomes;//the outcomes of every variable, by index
+
+	Vector<int> defined;//1 once a variable has had its probability block
+
+	/*a union-find over the variables : roots[v] leads to the variable standing for the tree of v.
+	every parent edge must join two trees, or the network would not be a polytree*/
+	Vector<int> roots;
+
+	unordered_map<string, int> variables;//the index of every variable, by name
+
+	ThreadPool *pool;
+
+	Join join;
+
+	Vector<BifBlock *> queued;//the blocks handed to the pool and not yet copied
+
+	size_t window;//their size in bytes
+
+	long long bytes, entries;
+
+	double seconds;
+
+	bool fill();
+
+	int get();
+
+	int peek();
+
+	bool read(char stop, string &text);
+
+	void skip();
+
+	bool token(string &text);
+
+	void expect(string text);
+
+	bool tag(string &name);
+
+	void content(string &text);
+
+	void readBif();
+
+	void readXml();
+
+	void declare(string name, Vector<string> &states);
+
+	int find(string name);
+
+	int component(int v);
+
+	void queue(int child, Vector<int> &parents, string &text, bool xml);
+
+	void apply(BifBlock *block);
+
+	void flush();
+
+	void release();
+
+	void fail();
+
+	static void parseTask(void *context, const int *items, int count, int worker);
+
+	static void parse(BifBlock *block);
+
+	static void space(const char *&p, const char *end);
+
+	static bool word(const char *&p, const char *end, string &text);
+
+	static bool number(const char *&p, const char *end, float &value);
+
+	static int outcome(Vector<string> *states, string &name);
+
+public:
+
+	BifReader(string path, int threads);
+
+	Graph * getGraph();
+
+	Vertex * getVertex(int i);
+
+	int getSize();
+
+	long long getBytes();
+
+	long long getEntries();
+
+	double getSeconds();
+
+	double getThroughput();
+
+	static void write(Graph *graph, string path);
+
+	~BifReader();
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+frees the values, unless the CPT of the child has taken them
+*/
+BifBlock::~BifBlock()
+{
+	CPD::release(values);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+reads a whole network and propagates it once, so it is ready to be queried or compiled
+
+@param	path	the BIF or XMLBIF file, told apart by their first character
+@param	threads	the threads parsing the probability blocks besides the reading one, 0 parses them as they are read
+*/
+BifReader::BifReader(string path, int threads)
+{
+	if (threads < 0)
+		throw - 1;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	buffer = NULL;
+	pool = NULL;
+	graph = NULL;
+	size = position = window = 0;
+	bytes = entries = 0;
+	seconds = 0;
+
+	in.open(path.c_str(), ios::in | ios::binary);
+	if (!in)
+		throw - 8;
+
+	buffer = new char[BIF_CHUNK];
+	graph = new Graph(path);
+	if (threads > 0)
+		pool = new ThreadPool(threads);
+
+	skip();
+	if (peek() == '<')
+		readXml();
+	else
+		readBif();
+
+	flush();
+	delete pool;
+	pool = NULL;
+	delete[] buffer;
+	buffer = NULL;
+	in.close();
+
+	graph->initialize();
+	seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+reads the next chunk of the file into the buffer
+
+@return		false at the end of the file
+*/
+bool BifReader::fill()
+{
+	in.read(buffer, BIF_CHUNK);
+	size = (size_t)in.gcount();
+	position = 0;
+	bytes += size;
+	return size > 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the next character of the file, EOF at its end
+*/
+int BifReader::get()
+{
+	if (position == size && !fill())
+		return EOF;
+	return (unsigned char)buffer[position++];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the next character of the file without reading it, EOF at its end
+*/
+int BifReader::peek()
+{
+	if (position == size && !fill())
+		return EOF;
+	return (unsigned char)buffer[position];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+reads up to a character, a whole chunk at a time
+
+@param	stop	the character, it is read but not kept
+@param	text	filled with everything before it
+@return			false if the file ended first
+*/
+bool BifReader::read(char stop, string &text)
+{
+	text.clear();
+	while (position < size || fill())
+	{
+		char *start = buffer + position;
+		char *found = (char *)memchr(start, stop, size - position);
+
+		if (found)
+		{
+			text.append(start, found - start);
+			position = found - buffer + 1;
+			return true;
+		}
+		text.append(start, size - position);
+		position = size;
+	}
+	return false;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+skips white space and comments, // to the end of the line or between / * and * /
+*/
+void BifReader::skip()
+{
+	string text;
+	for (;;)
+	{
+		int c = peek();
+		if (c != EOF && isspace(c))
+		{
+			get();
+		}
+		else if (c == '/')
+		{
+			get();
+			c = get();
+			if (c == '/')
+				read('\n', text);
+			else if (c == '*')
+			{
+				do
+				{
+					if (!read('*', text))
+						fail();
+				} while (peek() != '/');
+				get();
+			}
+			else
+				fail();
+		}
+		else
+			return;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+reads the next token of a BIF file : a word, a quoted string or a punctuation mark
+
+@param	text	filled with the token, without the quotes
+@return			false at the end of the file
+*/
+bool BifReader::token(string &text)
+{
+	skip();
+	int c = get();
+	if (c == EOF)
+		return false;
+
+	if (c == '"')
+	{
+		if (!read('"', text))
+			fail();
+		return true;
+	}
+
+	text = (char)c;
+	if (strchr("{}()[];,|=", c))
+		return true;
+
+	for (c = peek(); c != EOF && !isspace(c) && !strchr("{}()[];,|=\"/", c); c = peek())
+	{
+		text += (char)get();
+	}
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+reads a token which has to be there
+
+@param	text	the token
+*/
+void BifReader::expect(string text)
+{
+	string next;
+	if (!token(next) || next != text)
+		fail();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+reads the next tag of an XMLBIF file, skipping the text before it, comments and declarations
+
+@param	name	filled with the name of the element in capitals, with a leading '/' for a closing tag
+@return			false at the end of the file
+*/
+bool BifReader::tag(string &name)
+{
+	string text;
+	for (;;)
+	{
+		if (!read('<', text))
+			return false;
+		if (!read('>', name))
+			fail();
+
+		if (!name.compare(0, 3, "!--"))
+		{
+			while (name.size() < 5 || name.compare(name.size() - 2, 2, "--"))
+			{
+				if (!read('>', text))
+					fail();
+				name += '>' + text;
+			}
+			continue;
+		}
+		if (name.empty() || name[0] == '?' || name[0] == '!')
+			continue;
+
+		name = name.substr(0, name.find_first_of(" \t\r\n/", 1));
+		for (size_t i = 0; i < name.size(); i++)
+		{
+			name[i] = (char)toupper((unsigned char)name[i]);
+		}
+		return true;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+reads the text of the element whose opening tag was just read, and its closing tag
+
+@param	text	filled with the text, without the white space around it
+*/
+void BifReader::content(string &text)
+{
+	string closing;
+	if (!read('<', text) || !read('>', closing) || closing.empty() || closing[0] != '/')
+		fail();
+
+	size_t first = text.find_first_not_of(" \t\r\n");
+	if (first == string::npos)
+		text.clear();
+	else
+		text = text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+reads the blocks of a BIF file :
+network name { properties }
+variable name { type discrete [ n ] { outcomes }; properties }
+probability ( child | parents ) { body }
+*/
+void BifReader::readBif()
+{
+	string word, name, text;
+	Vector<string> states;
+	Vector<int> parents;
+
+	while (token(word))
+	{
+		if (word == "network")
+		{
+			do
+			{
+				if (!token(word))
+					fail();
+			} while (word != "{");
+			read('}', text);
+		}
+		else if (word == "variable")
+		{
+			if (!token(name))
+				fail();
+			expect("{");
+			states.clear();
+
+			while (token(word) && word != "}")
+			{
+				if (word == "type")
+				{
+					expect("discrete");
+					expect("[");
+					if (!token(word))
+						fail();
+					int n = atoi(word.c_str());
+					expect("]");
+					expect("{");
+
+					do
+					{
+						if (!token(word))
+							fail();
+						states.pushBack(word);
+						if (!token(word))
+							fail();
+					} while (word == ",");
+
+					if (word != "}" || (int)states.getSize() != n)
+						fail();
+					expect(";");
+				}
+				else if (word == "property")
+					read(';', text);
+				else
+					fail();
+			}
+			declare(name, states);
+		}
+		else if (word == "probability")
+		{
+			expect("(");
+			if (!token(name))
+				fail();
+			int child = find(name);
+			parents.clear();
+
+			if (!token(word))
+				fail();
+			if (word == "|")
+			{
+				do
+				{
+					if (!token(name))
+						fail();
+					parents.pushBack(find(name));
+					if (!token(word))
+						fail();
+				} while (word == ",");
+			}
+			if (word != ")")
+				fail();
+
+			expect("{");
+			if (!read('}', text))
+				fail();
+			queue(child, parents, text, false);
+		}
+		else
+			fail();
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+reads the elements of an XMLBIF file :
+VARIABLE with a NAME and OUTCOMEs, DEFINITION (or PROBABILITY) with a FOR, GIVENs and a TABLE.
+everything else is skipped.
+*/
+void BifReader::readXml()
+{
+	string name, text, variable;
+	Vector<string> states;
+	Vector<int> parents;
+	int context = 0, child = -1;//1 in a VARIABLE, 2 in a DEFINITION
+
+	while (tag(name))
+	{
+		if (name == "VARIABLE")
+		{
+			context = 1;
+			variable.clear();
+			states.clear();
+		}
+		else if (name == "DEFINITION" || name == "PROBABILITY")
+		{
+			context = 2;
+			child = -1;
+			parents.clear();
+			text.clear();
+		}
+		else if (context == 1 && name == "NAME")
+			content(variable);
+		else if (context == 1 && name == "OUTCOME")
+		{
+			content(name);
+			states.pushBack(name);
+		}
+		else if (context == 1 && name == "/VARIABLE")
+		{
+			declare(variable, states);
+			context = 0;
+		}
+		else if (context == 2 && name == "FOR")
+		{
+			content(name);
+			child = find(name);
+		}
+		else if (context == 2 && name == "GIVEN")
+		{
+			content(name);
+			parents.pushBack(find(name));
+		}
+		else if (context == 2 && name == "TABLE")
+			content(text);
+		else if (context == 2 && (name == "/DEFINITION" || name == "/PROBABILITY"))
+		{
+			queue(child, parents, text, true);
+			context = 0;
+		}
+	}
+
+	if (context)
+		fail();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+makes a Vertex of a variable and adds it to the Graph
+
+@param	name	the name of the variable, which must be new
+@param	states	the names of its outcomes
+*/
+void BifReader::declare(string name, Vector<string> &states)
+{
+	if (name.empty() || !states.getSize() || variables.count(name))
+		fail();
+
+	Vertex *vertex = new Vertex(name, 0, states.getSize());
+	int i = 0;
+	for (Node<State> *ptr = vertex->getStates()->getHead(); ptr; ptr = ptr->next)
+	{
+		ptr->data.name = states[i++];
+	}
+
+	variables[name] = vertices.getSize();
+	vertices.pushBack(vertex);
+	outcomes.pushBack(new Vector<string>(states));
+	defined.pushBack(0);
+	roots.pushBack(vertices.getSize() - 1);
+
+	/*the names are unique already, Graph::addVertex() would search the whole list*/
+	graph->getVertices()->append(vertex);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	name	the name of a declared variable
+@return			its index
+*/
+int BifReader::find(string name)
+{
+	unordered_map<string, int>::iterator found = variables.find(name);
+	if (found == variables.end())
+		fail();
+	return found->second;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	the index of a variable
+@return		the variable standing for the tree of v in the union-find, the path to it is halved on the way
+*/
+int BifReader::component(int v)
+{
+	while (roots[v] != v)
+	{
+		roots[v] = roots[roots[v]];
+		v = roots[v];
+	}
+	return v;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+connects a child to its parents and hands its probability block to the pool.
+throws -9 if a parent is joined to the child already, the network would not be a polytree.
+
+@param	child	the index of the child
+@param	parents	the indices of its parents, in the order of the table
+@param	text	the text of the block, it is moved into the block
+@param	xml		true for the TABLE of an XMLBIF file
+*/
+void BifReader::queue(int child, Vector<int> &parents, string &text, bool xml)
+{
+	if (child < 0 || defined[child])
+		fail();
+	defined[child] = 1;
+
+	Vertex *vertex = vertices[child];
+	for (int i = 0; i < (int)parents.getSize(); i++)
+	{
+		for (int j = 0; j < i; j++)
+		{
+			if (parents[j] == parents[i])
+				fail();
+		}
+		if (parents[i] == child)
+			fail();
+
+		/*an edge between two vertices which are joined already closes a loop*/
+		int a = component(parents[i]), b = component(child);
+		if (a == b)
+			fail();
+		roots[b] = a;
+
+		vertices[parents[i]]->connectTo(vertex, 0);
+	}
+
+	BifBlock *block = new BifBlock;
+	block->child = child;
+	block->xml = xml;
+	block->failed = false;
+	block->values = NULL;
+	block->width = outcomes[child]->getSize();
+	block->height = 1;
+	block->text.swap(text);
+	for (int i = 0; i < (int)parents.getSize(); i++)
+	{
+		block->parents.pushBack(outcomes[parents[i]]);
+		block->height *= outcomes[parents[i]]->getSize();
+	}
+
+	if (!pool)
+	{
+		parse(block);
+		queued.pushBack(block);
+		flush();
+		return;
+	}
+
+	Task task = { &BifReader::parseTask, block, NULL, 0, &join };
+	pool->spawn(pool->getCaller(), task);
+	queued.pushBack(block);
+
+	window += block->text.size() + (size_t)block->height * block->width * sizeof(float);
+	if (window >= BIF_WINDOW)
+		flush();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+hands the values of a parsed block over to the CPT of its child, without copying them.
+block->failed is set if they are not a valid table.
+
+@param	block	the block
+*/
+void BifReader::apply(BifBlock *block)
+{
+	try
+	{
+		vertices[block->child]->getCPD()->adoptTable(block->values, block->height * block->width, false);
+	}
+	catch (int)
+	{
+		block->failed = true;
+		return;
+	}
+
+	block->values = NULL;
+	entries += block->height * block->width;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+waits for every block handed to the pool and copies them into their CPTs
+*/
+void BifReader::flush()
+{
+	if (pool)
+		pool->wait(pool->getCaller(), join);
+
+	bool failed = false;
+	for (int i = 0; i < (int)queued.getSize(); i++)
+	{
+		if (!queued[i]->failed)
+			apply(queued[i]);
+		failed = failed || queued[i]->failed;
+		delete queued[i];
+	}
+	queued.clear();
+	window = 0;
+
+	if (failed)
+		fail();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+deletes everything the reader holds, once the pool is done with it
+*/
+void BifReader::release()
+{
+	if (pool)
+		pool->wait(pool->getCaller(), join);
+	delete pool;
+	pool = NULL;
+
+	for (int i = 0; i < (int)queued.getSize(); i++)
+	{
+		delete queued[i];
+	}
+	queued.clear();
+
+	delete graph;
+	graph = NULL;
+	for (int i = 0; i < (int)vertices.getSize(); i++)
+	{
+		delete vertices[i];
+		delete outcomes[i];
+	}
+	vertices.clear();
+	outcomes.clear();
+
+	delete[] buffer;
+	buffer = NULL;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+gives up on a file which is not valid : everything is deleted and -9 is thrown
+*/
+void BifReader::fail()
+{
+	release();
+	throw - 9;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the task of the pool, parses one block
+
+@param	context		the BifBlock
+*/
+void BifReader::parseTask(void *context, const int *, int, int)
+{
+	parse((BifBlock *)context);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+turns the text of a block into the values of the CPT of its child. it only touches the block,
+so any number of blocks may be parsed at the same time. on an error block->failed is set.
+
+the body of a BIF block is made of statements ending with ';' :
+(parent outcomes) p1, p2, ...;	the row of those parent outcomes
+table p1, p2, ...;				the whole table, the child's outcome varying slowest and the last parent's fastest
+default p1, p2, ...;			the row of every combination not given
+a row given by neither gets a uniform distribution.
+the TABLE of an XMLBIF block lists the rows in order, the last parent varying fastest, which is
+just how CPD::getTable() is laid out.
+
+@param	block	the block
+*/
+void BifReader::parse(BifBlock *block)
+{
+	int height = block->height, width = block->width, num_of_parents = block->parents.getSize();
+	const char *p = block->text.c_str(), *end = p + block->text.size();
+	float *values = block->values = CPD::allocate(height * width);
+
+	if (block->xml)
+	{
+		for (int i = 0; i < height * width; i++)
+		{
+			if (!number(p, end, values[i]))
+			{
+				block->failed = true;
+				return;
+			}
+		}
+		space(p, end);
+		block->failed = p != end;
+		return;
+	}
+
+	Vector<char> given(height, 0);
+	Vector<float> fallback;
+	string name;
+	bool failed = false;
+
+	for (space(p, end); p != end && !failed; space(p, end))
+	{
+		if (*p == '(')
+		{
+			p++;
+			int row = 0;
+			for (int k = 0; k < num_of_parents && !failed; k++)
+			{
+				int state = word(p, end, name) ? outcome(block->parents[k], name) : -1;
+				failed = state < 0;
+				row = row * block->parents[k]->getSize() + state;
+			}
+			space(p, end);
+			failed = failed || p == end || *p++ != ')';
+
+			for (int i = 0; i < width && !failed; i++)
+			{
+				failed = !number(p, end, values[row * width + i]);
+			}
+			if (!failed)
+				given[row] = 1;
+		}
+		else if (!word(p, end, name))
+			failed = true;
+		else if (name == "table")
+		{
+			for (int i = 0; i < height * width && !failed; i++)
+			{
+				failed = !number(p, end, values[(i % height) * width + i / height]);
+			}
+			for (int j = 0; j < height; j++)
+			{
+				given[j] = 1;
+			}
+		}
+		else if (name == "default")
+		{
+			fallback.resize(width);
+			for (int i = 0; i < width && !failed; i++)
+			{
+				failed = !number(p, end, fallback[i]);
+			}
+		}
+		else if (name == "property")
+		{
+			while (p != end && *p != ';')
+				p++;
+		}
+		else
+			failed = true;
+
+		space(p, end);
+		failed = failed || p == end || *p++ != ';';
+	}
+
+	if (failed || p != end)
+	{
+		block->failed = true;
+		return;
+	}
+
+	for (int j = 0; j < height; j++)
+	{
+		if (given[j])
+			continue;
+		for (int i = 0; i < width; i++)
+		{
+			values[j * width + i] = fallback.getSize() ? fallback[i] : 1.00f / width;
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+skips white space, commas and comments in the text of a block
+
+@param	p	the next character, moved past them
+@param	end	the end of the text
+*/
+void BifReader::space(const char *&p, const char *end)
+{
+	while (p != end)
+	{
+		if (isspace((unsigned char)*p) || *p == ',')
+			p++;
+		else if (*p == '/' && p + 1 != end && p[1] == '/')
+		{
+			while (p != end && *p != '\n')
+				p++;
+		}
+		else if (*p == '/' && p + 1 != end && p[1] == '*')
+		{
+			const char *close = strstr(p + 2, "*/");
+			p = close && close < end ? close + 2 : end;
+		}
+		else
+			return;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+reads a name from the text of a block, quoted or not
+
+@param	p		the next character, moved past the name
+@param	end		the end of the text
+@param	text	filled with the name
+@return			false if there was none
+*/
+bool BifReader::word(const char *&p, const char *end, string &text)
+{
+	space(p, end);
+	const char *start = p;
+
+	if (p != end && *p == '"')
+	{
+		start = ++p;
+		while (p != end && *p != '"')
+			p++;
+		if (p == end)
+			return false;
+		text.assign(start, p++);
+		return true;
+	}
+
+	while (p != end && !isspace((unsigned char)*p) && !strchr(",;()\"", *p))
+		p++;
+	text.assign(start, p);
+	return p != start;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+reads a number from the text of a block
+
+@param	p		the next character, moved past the number
+@param	end		the end of the text, which has to be followed by a '\0'
+@param	value	filled with the number
+@return			false if there was none
+*/
+bool BifReader::number(const char *&p, const char *end, float &value)
+{
+	space(p, end);
+	char *next;
+	value = strtof(p, &next);
+	if (next == p || next > end)
+		return false;
+	p = next;
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	states	the outcomes of a variable
+@param	name	the name of one of them
+@return			its zero-based index, -1 if there is no such outcome
+*/
+int BifReader::outcome(Vector<string> *states, string &name)
+{
+	for (int i = 0; i < (int)states->getSize(); i++)
+	{
+		if ((*states)[i] == name)
+			return i;
+	}
+	return -1;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the network read, owned by the reader
+*/
+Graph * BifReader::getGraph()
+{
+	return graph;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	i	the index of a variable, in the order they were declared
+@return		its Vertex
+*/
+Vertex * BifReader::getVertex(int i)
+{
+	return vertices[i];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of variables read
+*/
+int BifReader::getSize()
+{
+	return vertices.getSize();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the size of the file in bytes
+*/
+long long BifReader::getBytes()
+{
+	return bytes;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of CPT entries read
+*/
+long long BifReader::getEntries()
+{
+	return entries;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		how long reading the whole network took, in seconds
+*/
+double BifReader::getSeconds()
+{
+	return seconds;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the parse throughput, in megabytes of the file per second
+*/
+double BifReader::getThroughput()
+{
+	return seconds > 0 ? bytes / seconds / 1e6 : 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+writes a network as a BIF file, every CPT as one row per parent combination.
+BIF has no noisy-MAX or tree CPTs, they are written out as the tables they stand for.
+
+@param	graph	the network. the names of the vertices and of their states have to be BIF words.
+@param	path	the file, throws -8 if it cannot be written and -1 if a noisy-MAX or tree CPT
+				has too many rows to be written out
+*/
+void BifReader::write(Graph *graph, string path)
+{
+	ofstream out(path.c_str(), ios::out | ios::binary);
+	if (!out)
+		throw - 8;
+	out.precision(9);
+
+	out << "network \"" << graph->getName() << "\" {\n}\n";
+	for (Node<Vertex *> *ptr = graph->getVertices()->getHead(); ptr; ptr = ptr->next)
+	{
+		Vertex *vertex = ptr->data;
+		out << "variable " << vertex->getName() << " {\n\ttype discrete [ " << vertex->getStates()->getSize() << " ] { ";
+		for (Node<State> *state = vertex->getStates()->getHead(); state; state = state->next)
+		{
+			out << state->data.name << (state->next ? ", " : "");
+		}
+		out << " };\n}\n";
+	}
+
+	for (Node<Vertex *> *ptr = graph->getVertices()->getHead(); ptr; ptr = ptr->next)
+	{
+		Vertex *vertex = ptr->data;
+		View<Vertex *> parents = vertex->getParents();
+		CPD *table = vertex->getCPD();
+		int num_of_parents = parents.getSize(), width = table->getWidth();
+
+		Vector< Vector<string> > names(num_of_parents);
+		for (int k = 0; k < num_of_parents; k++)
+		{
+			for (Node<State> *state = parents[k]->getStates()->getHead(); state; state = state->next)
+			{
+				names[k].pushBack(state->data.name);
+			}
+		}
+
+		out << "probability ( " << vertex->getName();
+		for (int k = 0; k < num_of_parents; k++)
+		{
+			out << (k ? ", " : " | ") << parents[k]->getName();
+		}
+		out << " ) {\n";
+
+		int height = table->getHeight();
+		if (table->getKind() != CPD_TABLE)
+		{
+			long long rows = 1;
+			for (int k = 0; k < num_of_parents; k++)
+			{
+				rows *= names[k].getSize();
+				if (rows > INT_MAX)
+					throw - 1;
+			}
+			height = (int)rows;
+		}
+
+		Vector<int> combo(num_of_parents, 0), digits(num_of_parents, 1);
+		for (int j = 0; j < height; j++)
+		{
+			out << (num_of_parents ? "\t(" : "\ttable ");
+			for (int k = 0; k < num_of_parents; k++)
+			{
+				out << (k ? ", " : "") << names[k][combo[k]];
+			}
+			out << (num_of_parents ? ") " : "");
+			for (int i = 0; i < width; i++)
+			{
+				out << (i ? ", " : "") << (table->getKind() == CPD_TABLE ? table->getTable()[j * width + i] : table->p(i + 1, digits.begin()));
+			}
+			out << ";\n";
+
+			for (int k = num_of_parents - 1; k >= 0 && ++combo[k] == (int)names[k].getSize(); k--)
+			{
+				combo[k] = 0;
+			}
+			for (int k = 0; k < num_of_parents; k++)
+			{
+				digits[k] = combo[k] + 1;
+			}
+		}
+		out << "}\n";
+	}
+
+	if (!out)
+		throw - 8;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+BifReader::~BifReader()
+{
+	release();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <algorithm>
+#include "vector.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*the posteriors computed for one set of findings*/
+struct CacheEntry
+{
+	string key;//the canonical findings, see PosteriorCache::select()
+
+	unordered_map<int, Vector<float> > posteriors;//by vertex id
+};
+
+/*a bounded cache of posteriors, keyed by the set of findings they were computed with.
+the findings are made canonical (sorted by vertex) so that the same set given in any order
+hits the same entry, and the least recently used set is dropped when the cache is full.
+every entry was computed from the tables as they were at one revision of the Graph (Graph::getRevision());
+once the revision changes the whole cache is dropped, so a stale posterior is never returned.
+
+a query selects the entry of its findings with select() and then reads or stores the
+posteriors of single vertices in it with get() and put().*/
+class PosteriorCache
+{
+private:
+
+	int capacity;
+
+	unsigned int revision;
+
+	list<CacheEntry> entries;//the most recently used first
+
+	unordered_map<string, list<CacheEntry>::iterator> index;
+
+	CacheEntry *selected;
+
+	long long hits, misses;
+
+public:
+
+	PosteriorCache(int capacity);
+
+	bool select(const int *vertices, const int *states, int size, unsigned int revision);
+
+	const float * get(int vertex);
+
+	void put(int vertex, const float *posterior, int size);
+
+	void clear();
+
+	int getSize();
+
+	int getCapacity();
+
+	long long getHits();
+
+	long long getMisses();
+
+	double getHitRate();
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+PosteriorCache class constructor, starts empty
+
+@param	capacity	the number of sets of findings kept, throws -1 if it is less than 1
+*/
+PosteriorCache::PosteriorCache(int capacity)
+{
+	if (capacity < 1)
+		throw - 1;
+
+	this->capacity = capacity;
+	revision = 0;
+	selected = NULL;
+	hits = misses = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+selects the entry of a set of findings, making it the most recently used one.
+a new, empty entry is made if there is none, dropping the least recently used one if needed.
+
+@param	vertices	the ids of the observed vertices
+@param	states		the observed state of each vertex
+@param	size		the number of findings
+@param	revision	the revision of the Graph the posteriors are computed from
+@return				true if the set already had an entry
+*/
+bool PosteriorCache::select(const int *vertices, const int *states, int size, unsigned int revision)
+{
+	if (revision != this->revision)
+	{
+		entries.clear();
+		index.clear();
+		this->revision = revision;
+	}
+
+	Vector< pair<int, int> > findings;
+	for (int i = 0; i < size; i++)
+	{
+		findings.pushBack(make_pair(vertices[i], states[i]));
+	}
+	sort(findings.begin(), findings.end());
+
+	string key((const char *)findings.begin(), findings.getSize() * sizeof(pair<int, int>));
+	unordered_map<string, list<CacheEntry>::iterator>::iterator found = index.find(key);
+
+	if (found != index.end())
+	{
+		entries.splice(entries.begin(), entries, found->second);
+		selected = &entries.front();
+		return true;
+	}
+
+	if ((int)entries.size() == capacity)
+	{
+		index.erase(entries.back().key);
+		entries.pop_back();
+	}
+
+	entries.push_front(CacheEntry());
+	entries.front().key = key;
+	index[key] = entries.begin();
+	selected = &entries.front();
+	return false;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+looks up a posterior in the selected entry, counting a hit or a miss
+
+@param	vertex	the id of the vertex
+@return			its posterior, NULL if it has not been stored. valid until the next select().
+*/
+const float * PosteriorCache::get(int vertex)
+{
+	unordered_map<int, Vector<float> >::iterator found;
+
+	if (!selected || (found = selected->posteriors.find(vertex)) == selected->posteriors.end())
+	{
+		misses++;
+		return NULL;
+	}
+
+	hits++;
+	return found->second.begin();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+stores a posterior in the selected entry
+
+@param	vertex		the id of the vertex
+@param	posterior	its probabilities
+@param	size		its number of states
+*/
+void PosteriorCache::put(int vertex, const float *posterior, int size)
+{
+	if (!selected)
+		return;
+
+	Vector<float> &copy = selected->posteriors[vertex];
+	copy.resize(size);
+	for (int i = 0; i < size; i++)
+	{
+		copy[i] = posterior[i];
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+drops every entry, the statistics are kept
+*/
+void PosteriorCache::clear()
+{
+	entries.clear();
+	index.clear();
+	selected = NULL;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of sets of findings held
+*/
+int PosteriorCache::getSize()
+{
+	return entries.size();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the most sets of findings held at once
+*/
+int PosteriorCache::getCapacity()
+{
+	return capacity;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of posteriors found by get()
+*/
+long long PosteriorCache::getHits()
+{
+	return hits;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of posteriors get() did not find
+*/
+long long PosteriorCache::getMisses()
+{
+	return misses;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the share of the posteriors found, 0 before any lookup
+*/
+double PosteriorCache::getHitRate()
+{
+	return hits + misses ? (double)hits / (hits + misses) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,502 @@
+#ifndef CODEGEN_H
+#define CODEGEN_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <cctype>
+#include <unordered_map>
+#include "vector.h"
+#include "graph.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*the largest CPT written out, in entries. every entry becomes a term of the generated source,
+so a larger one is better served by the Engine.*/
+#define CODEGEN_MAX_ENTRIES (1 << 16)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*writes a network out as the C++ source of a class answering queries on exactly that network.
+the source is straight-line : the schedule of the Engine (see BasicEngine::propagate()) is
+walked once here, and every message it would compute is written out as the sums of products
+it is made of, with the entries of the CPTs as constants (those which are 0 left out) and every
+message at a constant place in one array. the generated class has no pointers, no loops over
+the network and no recursion, only the arithmetic, so the compiler is free to schedule and
+vectorize all of it. it needs nothing but <cstring>.
+
+a vertex is known to the generated class by its dense index in the Model (see Graph::compile()),
+the names are listed at the top of the source and find() looks them up.*/
+class CodeGenerator
+{
+private:
+
+	static string literal(float value);
+
+	static string allowed(int v, int x);
+
+	static void normalize(ostream &out, int offset, int size);
+
+	static void updateLambda(ostream &out, Model *model, int v);
+
+	static void updatePi(ostream &out, Model *model, int v, const float *table);
+
+	static void updateBelief(ostream &out, Model *model, int v);
+
+	static void sendLambda(ostream &out, Model *model, int e, const float *table);
+
+	static void sendPi(ostream &out, Model *model, int e);
+
+public:
+
+	static void write(Graph *graph, string name, ostream &out);
+
+	static void write(Graph *graph, string name, string path);
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+@param	value	a finite number
+@return			a float literal which reads back as the same float
+*/
+string CodeGenerator::literal(float value)
+{
+	ostringstream text;
+	text.precision(9);
+	text << value;
+
+	string digits = text.str();
+	if (digits.find_first_of(".e") == string::npos)
+		digits += ".0";
+	return digits + "f";
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	the dense index of a vertex
+@param	x	the zero-based index of one of its states
+@return		an expression which is 1 if the evidence of v allows state x, 0 otherwise
+*/
+string CodeGenerator::allowed(int v, int x)
+{
+	ostringstream text;
+	text << "(evidence[" << v << "] < 0 || evidence[" << v << "] == " << x << " ? 1.0f : 0.0f)";
+	return text.str();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+writes the scaling of a message to sum to 1, or to 0 if it sums to 0
+
+@param	out		the source
+@param	offset	where the message starts in m
+@param	size	its number of entries
+*/
+void CodeGenerator::normalize(ostream &out, int offset, int size)
+{
+	out << "\t\tfloat sum = ";
+	for (int x = 0; x < size; x++)
+	{
+		out << (x ? " + " : "") << "m[" << offset + x << "]";
+	}
+	out << ";\n\t\tsum = sum > 0 ? 1.0f / sum : 0.0f;\n";
+	for (int x = 0; x < size; x++)
+	{
+		out << "\t\tm[" << offset + x << "] *= sum;\n";
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+writes lambda(x) = evidence(x) * product of the lambda messages from all the children
+
+@param	out		the source
+@param	model	the compiled network
+@param	v		the dense index of the vertex
+*/
+void CodeGenerator::updateLambda(ostream &out, Model *model, int v)
+{
+	int states = model->getCardinality(v), lambda = model->getVertexOffset(v);
+	View<int> edges = model->getChildEdges(v);
+
+	for (int x = 0; x < states; x++)
+	{
+		out << "\tm[" << lambda + x << "] = " << allowed(v, x);
+		for (int j = 0; j < edges.getSize(); j++)
+		{
+			out << " * m[" << model->getEdgeOffset(edges[j]) + states + x << "]";
+		}
+		out << ";\n";
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+writes pi(x) = sum over all parent combinations u of P(x | u) * product of pi messages(u_k),
+the product of every row once and then one sum per state
+
+@param	out		the source
+@param	model	the compiled network
+@param	v		the dense index of the vertex
+@param	table	its CPT, laid out like CPD::getTable()
+*/
+void CodeGenerator::updatePi(ostream &out, Model *model, int v, const float *table)
+{
+	View<int> parents = model->getParents(v);
+	int states = model->getCardinality(v), pi = model->getVertexOffset(v) + states, first = model->getFirstEdge(v);
+	int height = 1;
+
+	for (int k = 0; k < parents.getSize(); k++)
+	{
+		height *= model->getCardinality(parents[k]);
+	}
+
+	out << "\t{\n";
+	for (int r = 0; parents.getSize() && r < height; r++)
+	{
+		out << "\t\tconst float w" << r << " = ";
+		for (int k = parents.getSize() - 1, rest = r; k >= 0; k--)
+		{
+			int radix = model->getCardinality(parents[k]);
+			out << (k < parents.getSize() - 1 ? " * " : "") << "m[" << model->getEdgeOffset(first + k) + rest % radix << "]";
+			rest /= radix;
+		}
+		out << ";\n";
+	}
+
+	for (int x = 0; x < states; x++)
+	{
+		bool empty = true;
+		out << "\t\tm[" << pi + x << "] = ";
+		for (int r = 0; r < height; r++)
+		{
+			if (table[r * states + x] == 0)
+				continue;
+
+			out << (empty ? "" : " + ") << literal(table[r * states + x]);
+			if (parents.getSize())
+				out << " * w" << r;
+			empty = false;
+		}
+		out << (empty ? "0.0f;\n" : ";\n");
+	}
+	out << "\t}\n";
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+writes belief(x) = alpha * lambda(x) * pi(x)
+
+@param	out		the source
+@param	model	the compiled network
+@param	v		the dense index of the vertex
+*/
+void CodeGenerator::updateBelief(ostream &out, Model *model, int v)
+{
+	int states = model->getCardinality(v), lambda = model->getVertexOffset(v), pi = lambda + states, belief = pi + states;
+
+	out << "\t{\n";
+	for (int x = 0; x < states; x++)
+	{
+		out << "\t\tm[" << belief + x << "] = m[" << lambda + x << "] * m[" << pi + x << "];\n";
+	}
+	normalize(out, belief, states);
+	out << "\t}\n";
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+writes the message from the child of an edge to its parent :
+message(u) = sum over the child's states x and the other parents' states w of
+lambda(x) * P(x | u, w) * product of the other pi messages(w_k)
+as the dot product of every row with lambda once, then one sum per state of the parent
+
+@param	out		the source
+@param	model	the compiled network
+@param	e		the edge id
+@param	table	the CPT of the child, laid out like CPD::getTable()
+*/
+void CodeGenerator::sendLambda(ostream &out, Model *model, int e, const float *table)
+{
+	int c = model->getEdgeChild(e), states = model->getCardinality(c), lambda = model->getVertexOffset(c);
+	View<int> parents = model->getParents(c);
+	int first = model->getFirstEdge(c), slot = e - first, radix = model->getCardinality(parents[slot]);
+	int message = model->getEdgeOffset(e) + radix, height = 1;
+
+	for (int k = 0; k < parents.getSize(); k++)
+	{
+		height *= model->getCardinality(parents[k]);
+	}
+
+	Vector<string> sums(radix);
+
+	out << "\t{\n";
+	for (int r = 0; r < height; r++)
+	{
+		ostringstream dot, term;
+		for (int x = 0; x < states; x++)
+		{
+			if (table[r * states + x] != 0)
+				dot << (dot.tellp() > 0 ? " + " : "") << literal(table[r * states + x]) << " * m[" << lambda + x << "]";
+		}
+		if (dot.tellp() <= 0)
+			continue;
+
+		int digit = 0;
+		for (int k = parents.getSize() - 1, rest = r; k >= 0; k--)
+		{
+			int size = model->getCardinality(parents[k]);
+			if (k == slot)
+				digit = rest % size;
+			else
+				term << "m[" << model->getEdgeOffset(first + k) + rest % size << "] * ";
+			rest /= size;
+		}
+
+		out << "\t\tconst float d" << r << " = " << dot.str() << ";\n";
+		term << "d" << r;
+		sums[digit] += (sums[digit].empty() ? "" : " + ") + term.str();
+	}
+
+	for (int a = 0; a < radix; a++)
+	{
+		out << "\t\tm[" << message + a << "] = " << (sums[a].empty() ? "0.0f" : sums[a]) << ";\n";
+	}
+	normalize(out, message, radix);
+	out << "\t}\n";
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+writes the message from the parent of an edge to its child :
+message(x) = alpha * pi(x) * evidence(x) * product of the lambda messages from the other children
+
+@param	out		the source
+@param	model	the compiled network
+@param	e		the edge id
+*/
+void CodeGenerator::sendPi(ostream &out, Model *model, int e)
+{
+	int u = model->getEdgeParent(e), states = model->getCardinality(u), pi = model->getVertexOffset(u) + states;
+	int message = model->getEdgeOffset(e);
+	View<int> edges = model->getChildEdges(u);
+
+	out << "\t{\n";
+	for (int x = 0; x < states; x++)
+	{
+		out << "\t\tm[" << message + x << "] = m[" << pi + x << "] * " << allowed(u, x);
+		for (int j = 0; j < edges.getSize(); j++)
+		{
+			if (edges[j] != e)
+				out << " * m[" << model->getEdgeOffset(edges[j]) + states + x << "]";
+		}
+		out << ";\n";
+	}
+	normalize(out, message, states);
+	out << "\t}\n";
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+writes a network out as a C++ header holding one class, which answers queries on that network
+with observe(), retract(), clear(), propagate() and p() like an Engine does. it is propagated
+once when it is made, so p() gives the priors until the first findings. the CPTs are
+copied into the source, so later changes to the network are not seen by it.
+a noisy-MAX or a tree CPD is written out as the table it stands for.
+
+@param	graph	the network, a polytree
+@param	name	the name of the class, throws -1 if it is not a C++ identifier
+@param	out		the stream the source goes to, throws -8 if it fails and -1 if a CPT has more
+				than CODEGEN_MAX_ENTRIES entries
+*/
+void CodeGenerator::write(Graph *graph, string name, ostream &out)
+{
+	if (name.empty() || isdigit((unsigned char)name[0]))
+		throw - 1;
+	for (size_t i = 0; i < name.size(); i++)
+	{
+		if (!isalnum((unsigned char)name[i]) && name[i] != '_')
+			throw - 1;
+	}
+
+	unordered_map<string, Vertex *> vertices;
+	for (Node<Vertex *> *ptr = graph->getVertices()->getHead(); ptr; ptr = ptr->next)
+	{
+		vertices[ptr->data->getName()] = ptr->data;
+	}
+
+	Model *model = graph->compile();
+	int n = model->getSize();
+
+	/*every CPT as a dense table, the entries of a noisy-MAX or a tree CPD worked out with p()*/
+	Vector< Vector<float> > tables(n);
+	for (int v = 0; v < n; v++)
+	{
+		CPD *table = vertices[model->getName(v)]->getCPD();
+		View<int> parents = model->getParents(v);
+		long long size = model->getCardinality(v);
+
+		for (int k = 0; k < parents.getSize(); k++)
+		{
+			size *= model->getCardinality(parents[k]);
+			if (size > CODEGEN_MAX_ENTRIES)
+			{
+				delete model;
+				throw - 1;
+			}
+		}
+
+		Vector<int> digits(parents.getSize() + 1, 1);
+		for (int j = 0; j < size; j += model->getCardinality(v))
+		{
+			for (int x = 0; x < model->getCardinality(v); x++)
+			{
+				tables[v].pushBack(table->getKind() == CPD_TABLE ? table->getTable()[j + x] : table->p(x + 1, digits.begin()));
+			}
+			for (int k = parents.getSize() - 1; k >= 0 && ++digits[k] > model->getCardinality(parents[k]); k--)
+			{
+				digits[k] = 1;
+			}
+		}
+	}
+
+	ostringstream guard;
+	for (size_t i = 0; i < name.size(); i++)
+	{
+		guard << (char)toupper((unsigned char)name[i]);
+	}
+
+	out << "#ifndef " << guard.str() << "_H\n#define " << guard.str() << "_H\n\n#include <cstring>\n\n";
+	out << "/*the network \"" << graph->getName() << "\", written out by CodeGenerator::write(). do not edit.\n";
+	out << "the vertices, by index :\n";
+	for (int v = 0; v < n; v++)
+	{
+		out << "\t" << v << "\t" << model->getName(v) << " (" << model->getCardinality(v) << " states)\n";
+	}
+	out << "*/\nclass " << name << "\n{\nprivate:\n\n";
+	out << "\tfloat m[" << model->getMessageSize() + 1 << "];\n\n";
+	out << "\tint evidence[" << n + 1 << "];\n\n";
+	out << "public:\n\n\tenum { size = " << n << " };\n\n";
+	out << "\t" << name << "();\n\n\tstatic int find(const char *name);\n\n\tvoid observe(int v, int state);\n\n";
+	out << "\tvoid retract(int v);\n\n\tvoid clear();\n\n\tvoid propagate();\n\n\tfloat p(int v, int state);\n};\n\n";
+
+	out << "static const int " << name << "_states[" << n + 1 << "] = { ";
+	for (int v = 0; v < n; v++)
+	{
+		out << model->getCardinality(v) << ", ";
+	}
+	out << "0 };\n\nstatic const int " << name << "_beliefs[" << n + 1 << "] = { ";
+	for (int v = 0; v < n; v++)
+	{
+		out << model->getVertexOffset(v) + 2 * model->getCardinality(v) << ", ";
+	}
+	out << "0 };\n\nstatic const char *" << name << "_names[" << n + 1 << "] = { ";
+	for (int v = 0; v < n; v++)
+	{
+		out << "\"";
+		for (size_t i = 0; i < model->getName(v).size(); i++)
+		{
+			char character = model->getName(v)[i];
+			out << (character == '"' || character == '\\' ? "\\" : "") << character;
+		}
+		out << "\", ";
+	}
+	out << "0 };\n\n";
+
+	out << name << "::" << name << "()\n{\n\tclear();\n\tpropagate();\n}\n\n";
+	out << "int " << name << "::find(const char *name)\n{\n\tfor (int v = 0; v < size; v++)\n\t{\n";
+	out << "\t\tif (!strcmp(" << name << "_names[v], name))\n\t\t\treturn v;\n\t}\n\treturn -1;\n}\n\n";
+	out << "void " << name << "::observe(int v, int state)\n{\n\tif (v < 0 || v >= size || state < 1 || state > " << name << "_states[v])\n";
+	out << "\t\tthrow - 1;\n\tevidence[v] = state - 1;\n}\n\n";
+	out << "void " << name << "::retract(int v)\n{\n\tif (v < 0 || v >= size)\n\t\tthrow - 1;\n\tevidence[v] = -1;\n}\n\n";
+	out << "void " << name << "::clear()\n{\n\tfor (int v = 0; v < size; v++)\n\t{\n\t\tevidence[v] = -1;\n\t}\n}\n\n";
+	out << "float " << name << "::p(int v, int state)\n{\n\tif (v < 0 || v >= size || state < 1 || state > " << name << "_states[v])\n";
+	out << "\t\tthrow - 1;\n\treturn m[" << name << "_beliefs[v] + state - 1];\n}\n\n";
+
+	/*the schedule of BasicEngine::propagate() : collectVertex() from the last vertex to the first,
+	then distributeVertex() from the first to the last*/
+	View<int> schedule = model->getSchedule();
+	out << "void " << name << "::propagate()\n{\n";
+	for (int i = schedule.getSize() - 1; i >= 0; i--)
+	{
+		int v = schedule[i], e = model->getPredecessorEdge(v);
+		if (e < 0)
+			continue;
+
+		if (model->getEdgeChild(e) == v)
+		{
+			updateLambda(out, model, v);
+			sendLambda(out, model, e, tables[v].begin());
+		}
+		else
+		{
+			updatePi(out, model, v, tables[v].begin());
+			sendPi(out, model, e);
+		}
+	}
+	for (int i = 0; i < schedule.getSize(); i++)
+	{
+		int v = schedule[i], back = model->getPredecessorEdge(v);
+
+		updateLambda(out, model, v);
+		updatePi(out, model, v, tables[v].begin());
+		updateBelief(out, model, v);
+
+		for (int e = model->getFirstEdge(v), k = 0; k < model->getParents(v).getSize(); e++, k++)
+		{
+			if (e != back)
+				sendLambda(out, model, e, tables[v].begin());
+		}
+
+		View<int> edges = model->getChildEdges(v);
+		for (int j = 0; j < edges.getSize(); j++)
+		{
+			if (edges[j] != back)
+				sendPi(out, model, edges[j]);
+		}
+	}
+	out << "}\n\n#endif\n";
+
+	delete model;
+	if (!out)
+		throw - 8;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+writes a network out as a C++ header, see write(Graph *, string, ostream &).
+nothing is written if the network cannot be.
+
+@param	graph	the network, a polytree
+@param	name	the name of the class, throws -1 if it is not a C++ identifier
+@param	path	the file, throws -8 if it cannot be written and -1 if a CPT has more
+				than CODEGEN_MAX_ENTRIES entries
+*/
+void CodeGenerator::write(Graph *graph, string name, string path)
+{
+	ostringstream source;
+	write(graph, name, source);
+
+	ofstream out(path.c_str(), ios::out | ios::binary);
+	out << source.str();
+	if (!out)
+		throw - 8;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,1254 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "model.h"
+#include "session.h"
+#include "kernels.h"
+#include "pool.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*the most parents a vertex may have in a compiled model*/
+#define ENGINE_MAX_PARENTS 64
+
+/*belief propagation over a compiled Model.
+works on dense indices and flat arrays only, it never touches
+a Vertex, an Edge or a LinkedList. the evidence and the messages are kept
+in an InferenceSession and the Model is only read, so every thread may run
+an Engine of its own over one shared Model.
+the CPTs are read as Storage and everything is summed up in Accumulator :
+BasicEngine<BFloat16, float> streams half the bytes of the default on large CPTs,
+BasicEngine<float, double> keeps long chains from losing precision.*/
+template <class Storage, class Accumulator>
+class BasicEngine
+{
+private:
+
+	BasicModel<Storage> *model;
+
+	BasicSession<Storage, Accumulator> *session;
+
+	bool owns_session;//true if the session was made by the engine, which then deletes it
+
+	int largest;//the number of entries of the largest CPT
+
+	int slots;//the number of threads scratch and buffer have room for
+
+	Accumulator *scratch;//room for the largest CPT of the model for every thread, used by the kernels
+
+	int *buffer;//room for every vertex for every thread, used to walk small subtrees
+
+	ThreadPool *pool;//the pool of the parallel propagate() running, NULL otherwise
+
+	int grain;//subtrees of at most this many vertices are not split any further
+
+	/*the bookkeeping of query(). a mark equal to stamp was set by the running query,
+	so nothing has to be cleared between two queries.
+	evidential[v] : v or one of its descendants is observed.
+	touched[v] : some message out of v (or its posterior) is needed.
+	needed[r] : request r is needed, see query() for the numbering of the requests*/
+	unsigned int *marks, *evidential, *touched, *needed;
+
+	unsigned int stamp;
+
+	int *requests;//the needed requests, every one after the ones it is made of
+
+	int *frames;//the stack of the walk of query() : a request and how far its list of dependencies got
+
+	void attach(BasicModel<Storage> *model, BasicSession<Storage, Accumulator> *session);
+
+	void reserve(int slots);
+
+	void updateLambda(int v);
+
+	void updatePi(int v, int worker);
+
+	void updateBelief(int v);
+
+	void sendLambda(int e, int worker);
+
+	void sendPi(int e);
+
+	void sendPi(int u, int back, int worker);
+
+	void collectVertex(int v, int worker);
+
+	void distributeVertex(int v, int worker);
+
+	int gather(int v, int worker);
+
+	int weigh(const int *vertices, int count);
+
+	void fork(void(*function)(void *, const int *, int, int), const int *vertices, int count, int worker, Join &join);
+
+	void collect(const int *vertices, int count, int worker);
+
+	void collectPath(int v, int worker);
+
+	void distribute(const int *vertices, int count, int worker);
+
+	void distributePath(int v, int worker);
+
+	static void collectTask(void *context, const int *vertices, int count, int worker);
+
+	static void distributeTask(void *context, const int *vertices, int count, int worker);
+
+	void markEvidential();
+
+	int source(int r);
+
+	int dependency(int r, int &position);
+
+	void reset(int v);
+
+public:
+
+	BasicEngine(BasicModel<Storage> *model);
+
+	BasicEngine(BasicSession<Storage, Accumulator> *session);
+
+	BasicModel<Storage> * getModel();
+
+	BasicSession<Storage, Accumulator> * getSession();
+
+	void initialize();
+
+	void observe(int v, int state);
+
+	bool isObserved(int v);
+
+	void propagate();
+
+	void propagate(ThreadPool *pool, int grain);
+
+	int query(const int *targets, int count);
+
+	Accumulator p(int v, int state);
+
+	View<Accumulator> posterior(int v);
+
+	~BasicEngine();
+};
+
+/*the engine over the default Model*/
+typedef BasicEngine<float, float> Engine;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+Engine class constructor, with a session of its own and the prior probabilities computed
+
+@param	model	the compiled model to run on. it is not copied and must outlive the engine.
+*/
+template < typename Storage, typename Accumulator >
+BasicEngine<Storage, Accumulator>::BasicEngine(BasicModel<Storage> *model)
+{
+	attach(model, NULL);
+	initialize();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+an engine running on a session owned by the caller. the evidence already set in the session
+is kept, call propagate() to get the posterior probabilities.
+
+@param	session		the session to run on. it is not copied and must outlive the engine.
+*/
+template < typename Storage, typename Accumulator >
+BasicEngine<Storage, Accumulator>::BasicEngine(BasicSession<Storage, Accumulator> *session)
+{
+	attach(session->getModel(), session);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the work shared by the constructors
+
+@param	model	the compiled model to run on
+@param	session	the session to run on, NULL makes one which the engine owns
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::attach(BasicModel<Storage> *model, BasicSession<Storage, Accumulator> *session)
+{
+	for (int v = model->getSize() - 1; v >= 0; v--)
+	{
+		if (model->getParents(v).getSize() > ENGINE_MAX_PARENTS)
+			throw - 7;
+	}
+
+	/*a dense CPT needs one entry of scratch for every entry, a sparse one for every row,
+	a noisy-MAX one for two rows and a tree one for every parent and, for every state
+	of its widest parent, one per node and per leaf. it must also hold one product
+over the states of any vertex for sendPi()*/
+	largest = 1;
+	for (int v = model->getSize() - 1; v >= 0; v--)
+	{
+		View<int> parents = model->getParents(v);
+		bool noisy = model->getKind(v) == MODEL_NOISY_MAX;
+		int size = noisy ? 2 * model->getCardinality(v) : model->getKind(v) == MODEL_DENSE ? model->getCardinality(v) : 1;
+
+		if (model->getKind(v) == MODEL_TREE)
+		{
+			int widest = 1;
+			for (int k = 0; k < parents.getSize(); k++)
+			{
+				widest = model->getCardinality(parents[k]) > widest ? model->getCardinality(parents[k]) : widest;
+			}
+			size = parents.getSize() + (model->getTree(v).size + model->getTree(v).num_of_leaves) * widest;
+		}
+		for (int k = 0; !noisy && model->getKind(v) != MODEL_TREE && k < parents.getSize(); k++)
+		{
+			size *= model->getCardinality(parents[k]);
+		}
+		if (size < model->getCardinality(v))
+			size = model->getCardinality(v);
+		if (size > largest)
+			largest = size;
+	}
+
+	this->model = model;
+	this->session = session ? session : new BasicSession<Storage, Accumulator>(model);
+	owns_session = !session;
+	slots = 1;
+	scratch = new Accumulator[largest];
+	buffer = new int[model->getSize() + 1];
+	pool = NULL;
+	grain = 0;
+
+	int size = model->getSize(), edges = model->countEdges();
+	marks = new unsigned int[3 * size + 2 * edges + 1];
+	memset(marks, 0, (3 * size + 2 * edges + 1) * sizeof(unsigned int));
+	evidential = marks;
+	touched = marks + size;
+	needed = marks + 2 * size;
+	stamp = 0;
+	requests = new int[size + 2 * edges + 1];
+	frames = new int[2 * (size + 2 * edges + 1)];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+makes room in scratch and buffer for a number of threads
+
+@param	slots	the number of threads
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::reserve(int slots)
+{
+	if (slots <= this->slots)
+		return;
+
+	delete[] scratch;
+	delete[] buffer;
+	this->slots = slots;
+	scratch = new Accumulator[slots * largest];
+	buffer = new int[slots * model->getSize() + 1];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the model the engine runs on
+*/
+template < typename Storage, typename Accumulator >
+BasicModel<Storage> * BasicEngine<Storage, Accumulator>::getModel()
+{
+	return model;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the session holding the evidence and the messages
+*/
+template < typename Storage, typename Accumulator >
+BasicSession<Storage, Accumulator> * BasicEngine<Storage, Accumulator>::getSession()
+{
+	return session;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+removes all the evidence and computes the prior probabilities of every vertex
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::initialize()
+{
+	session->clear();
+	propagate();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+sets the state of a vertex as observed. call propagate() afterwards.
+
+@param	v		the dense index of the vertex
+@param	state	the one-based index of the observed state
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::observe(int v, int state)
+{
+	session->observe(v, state);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	the dense index of the vertex
+@return		true if the vertex is observed
+*/
+template < typename Storage, typename Accumulator >
+bool BasicEngine<Storage, Accumulator>::isObserved(int v)
+{
+	return session->isObserved(v);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+recomputes every message and every posterior probability.
+the first sweep walks the schedule backwards and sends every message towards
+the predecessor, the second walks it forwards and sends the rest away from it.
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::propagate()
+{
+	View<int> schedule = model->getSchedule();
+
+	for (int i = schedule.getSize() - 1; i >= 0; i--)
+	{
+		collectVertex(schedule[i], 0);
+	}
+
+	for (int i = 0; i < schedule.getSize(); i++)
+	{
+		distributeVertex(schedule[i], 0);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the same as propagate(), with the subtrees of the schedule spread over the threads of a pool.
+a vertex only needs the subtrees below it (on the way in) or the path above it (on the way out),
+so every vertex with more than one large subtree below it forks them and joins them again before
+its own message is sent. subtrees of at most grain vertices run on one thread in one go,
+which keeps the tasks large enough to be worth queueing. the results are the same as propagate().
+
+@param	pool	the threads to run on, NULL runs propagate() on the calling thread
+@param	grain	the size of the smallest subtree worth a task of its own, at least 1
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::propagate(ThreadPool *pool, int grain)
+{
+	if (grain < 1)
+		throw - 1;
+
+	if (!pool)
+	{
+		propagate();
+		return;
+	}
+
+	reserve(pool->getSize());
+	this->pool = pool;
+	this->grain = grain;
+
+	View<int> roots = model->getRoots();
+	collect(roots.begin(), roots.getSize(), pool->getCaller());
+	distribute(roots.begin(), roots.getSize(), pool->getCaller());
+
+	this->pool = NULL;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+computes the posterior probabilities of some vertices only, sending just the messages they depend on.
+most of a large polytree does not matter to a few targets : a vertex with no evidence at or below it
+sends a lambda message of all ones (it is barren), and an observed vertex blocks whatever lies behind it
+(d-separation), so those messages are left out and taken as all ones. the needed messages are found
+with one reachability pass from the targets, which lists every message after the ones it is made of,
+and are then sent in that order. the cost is linear in the size of the relevant part of the
+polytree, plus one pass over the evidence.
+the posteriors of the targets are the same as after propagate(), the ones of the other vertices are
+not valid until the next propagate().
+
+a request is a message or a posterior, numbered 2e for the pi message along edge e,
+2e + 1 for the lambda message along edge e and 2 * edges + v for the posterior of vertex v.
+
+@param	targets		the dense indices of the vertices to compute the posteriors of
+@param	count		the number of targets
+@return				the number of messages and posteriors computed
+*/
+template < typename Storage, typename Accumulator >
+int BasicEngine<Storage, Accumulator>::query(const int *targets, int count)
+{
+	int size = model->getSize(), edges = model->countEdges();
+
+	for (int i = 0; i < count; i++)
+	{
+		if (targets[i] < 0 || targets[i] >= size)
+			throw - 1;
+	}
+
+	if (!++stamp)
+	{
+		memset(marks, 0, (3 * size + 2 * edges + 1) * sizeof(unsigned int));
+		stamp = 1;
+	}
+
+	markEvidential();
+
+	/*a depth first walk from every target, a request is listed once all of its dependencies are*/
+	int found = 0;
+	for (int i = 0; i < count; i++)
+	{
+		int root = 2 * edges + targets[i], top = 0;
+		if (needed[root] == stamp)
+			continue;
+
+		needed[root] = stamp;
+		frames[top++] = root;
+		frames[top++] = 0;
+
+		while (top)
+		{
+			int r = frames[top - 2], next = dependency(r, frames[top - 1]);
+
+			if (next < 0)
+			{
+				requests[found++] = r;
+				top -= 2;
+			}
+			else if (needed[next] != stamp)
+			{
+				needed[next] = stamp;
+				frames[top++] = next;
+				frames[top++] = 0;
+			}
+		}
+	}
+
+	for (int i = 0; i < found; i++)
+	{
+		int v = source(requests[i]);
+		if (touched[v] != stamp)
+		{
+			touched[v] = stamp;
+			reset(v);
+		}
+	}
+
+	for (int i = 0; i < found; i++)
+	{
+		int r = requests[i];
+
+		if (r >= 2 * edges)
+		{
+			int v = r - 2 * edges;
+			updateLambda(v);
+			updatePi(v, 0);
+			updateBelief(v);
+		}
+		else if (r & 1)
+		{
+			updateLambda(model->getEdgeChild(r >> 1));
+			sendLambda(r >> 1, 0);
+		}
+		else
+		{
+			updatePi(model->getEdgeParent(r >> 1), 0);
+			sendPi(r >> 1);
+		}
+	}
+
+	return found;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+marks every observed vertex and all of its ancestors as evidential, for query().
+buffer is used as the stack of the walk.
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::markEvidential()
+{
+	int top = 0;
+
+	for (int v = model->getSize() - 1; v >= 0; v--)
+	{
+		if (session->getEvidence(v) < 0 || evidential[v] == stamp)
+			continue;
+
+		evidential[v] = stamp;
+		buffer[top++] = v;
+
+		while (top)
+		{
+			View<int> parents = model->getParents(buffer[--top]);
+			for (int k = 0; k < parents.getSize(); k++)
+			{
+				if (evidential[parents[k]] != stamp)
+				{
+					evidential[parents[k]] = stamp;
+					buffer[top++] = parents[k];
+				}
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	r	a request of query()
+@return		the vertex the request is computed at : the one sending the message, or the one of the posterior
+*/
+template < typename Storage, typename Accumulator >
+int BasicEngine<Storage, Accumulator>::source(int r)
+{
+	int edges = model->countEdges();
+
+	if (r >= 2 * edges)
+		return r - 2 * edges;
+	return r & 1 ? model->getEdgeChild(r >> 1) : model->getEdgeParent(r >> 1);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+steps through the messages a request of query() is made of. the lambda messages of children with no
+evidence at or below them are skipped, and so is everything behind an observed vertex, but for the
+pi messages of the other parents when it sends a lambda message to a parent.
+
+@param	r			the request
+@param	position	how far the list got, 0 at first. moved past the dependency returned.
+@return				the next request r depends on, -1 if there are no more
+*/
+template < typename Storage, typename Accumulator >
+int BasicEngine<Storage, Accumulator>::dependency(int r, int &position)
+{
+	int v = source(r), e = r < 2 * model->countEdges() ? r >> 1 : -1;
+	bool to_parent = e >= 0 && (r & 1), observed = session->getEvidence(v) >= 0;
+
+	if (observed && !to_parent)
+		return -1;
+
+	int first = model->getFirstEdge(v), num_of_parents = model->getParents(v).getSize();
+	while (position < num_of_parents)
+	{
+		int f = first + position++;
+		if (f != e)
+			return 2 * f;
+	}
+
+	if (observed)
+		return -1;
+
+	View<int> child_edges = model->getChildEdges(v);
+	while (position < num_of_parents + child_edges.getSize())
+	{
+		int f = child_edges[position++ - num_of_parents];
+		if (f != e && evidential[model->getEdgeChild(f)] == stamp)
+			return 2 * f + 1;
+	}
+	return -1;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+sets the messages into a vertex which query() leaves out to all ones
+
+@param	v	the dense index of the vertex
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::reset(int v)
+{
+	for (int e = model->getFirstEdge(v), k = 0; k < model->getParents(v).getSize(); e++, k++)
+	{
+		if (needed[2 * e] == stamp)
+			continue;
+
+		Accumulator *message = session->piMessage(e);
+		for (int a = model->getCardinality(model->getEdgeParent(e)) - 1; a >= 0; a--)
+		{
+			message[a] = 1;
+		}
+	}
+
+	View<int> edges = model->getChildEdges(v);
+	for (int j = 0; j < edges.getSize(); j++)
+	{
+		if (needed[2 * edges[j] + 1] == stamp)
+			continue;
+
+		Accumulator *message = session->lambdaMessage(edges[j]);
+		for (int a = model->getCardinality(v) - 1; a >= 0; a--)
+		{
+			message[a] = 1;
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+sends the message of a vertex towards its predecessor.
+every vertex after it in the schedule must have sent its own already.
+
+@param	v		the dense index of the vertex
+@param	worker	the slot of the thread, for its scratch space
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::collectVertex(int v, int worker)
+{
+	int e = model->getPredecessorEdge(v);
+	if (e < 0)
+		return;
+
+	if (model->getEdgeChild(e) == v)
+	{
+		updateLambda(v);
+		sendLambda(e, worker);
+	}
+	else
+	{
+		updatePi(v, worker);
+		sendPi(e);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+computes the posterior probabilities of a vertex and sends its messages away from the predecessor.
+its predecessor must have been through here already.
+
+@param	v		the dense index of the vertex
+@param	worker	the slot of the thread, for its scratch space
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::distributeVertex(int v, int worker)
+{
+	int back = model->getPredecessorEdge(v);
+
+	updateLambda(v);
+	updatePi(v, worker);
+	updateBelief(v);
+
+	for (int e = model->getFirstEdge(v), k = 0; k < model->getParents(v).getSize(); e++, k++)
+	{
+		if (e != back)
+			sendLambda(e, worker);
+	}
+
+	sendPi(v, back, worker);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+lists the subtree of the schedule below a vertex, in breadth first order
+
+@param	v		the dense index of the vertex
+@param	worker	the slot of the thread, the list goes into its part of buffer
+@return			the number of vertices listed, v first
+*/
+template < typename Storage, typename Accumulator >
+int BasicEngine<Storage, Accumulator>::gather(int v, int worker)
+{
+	int *order = buffer + worker * model->getSize();
+	int head = 0, tail = 0;
+
+	order[tail++] = v;
+	while (head < tail)
+	{
+		View<int> next = model->getSuccessors(order[head++]);
+		for (int j = 0; j < next.getSize(); j++)
+		{
+			order[tail++] = next[j];
+		}
+	}
+	return tail;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	vertices	dense vertex indices
+@param	count		the number of vertices
+@return				the number of vertices in all their subtrees
+*/
+template < typename Storage, typename Accumulator >
+int BasicEngine<Storage, Accumulator>::weigh(const int *vertices, int count)
+{
+	int total = 0;
+	for (int i = 0; i < count; i++)
+	{
+		total += model->getSubtreeSize(vertices[i]);
+	}
+	return total;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+hands the subtrees below some vertices to the pool, or runs them right away if they are small
+
+@param	function	collectTask or distributeTask
+@param	vertices	the roots of the subtrees
+@param	count		the number of subtrees
+@param	worker		the slot of the calling thread
+@param	join		counts the task, if one is spawned
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::fork(void(*function)(void *, const int *, int, int), const int *vertices, int count, int worker, Join &join)
+{
+	if (!count)
+		return;
+
+	if (weigh(vertices, count) <= grain)
+	{
+		function(this, vertices, count, worker);
+		return;
+	}
+
+	Task task = { function, this, vertices, count, &join };
+	pool->spawn(worker, task);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the collect sweep over the subtrees below some vertices, these vertices' own messages included.
+the list is cut in two halves of about the same weight, one half is spawned and the other one
+is run by the calling thread.
+
+@param	vertices	the roots of the subtrees, next to each other in the schedule
+@param	count		the number of subtrees
+@param	worker		the slot of the calling thread
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::collect(const int *vertices, int count, int worker)
+{
+	int total = weigh(vertices, count);
+
+	if (total <= grain)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			for (int j = gather(vertices[i], worker) - 1; j >= 0; j--)
+			{
+				collectVertex(buffer[worker * model->getSize() + j], worker);
+			}
+		}
+	}
+	else if (count == 1)
+	{
+		collectPath(vertices[0], worker);
+	}
+	else
+	{
+		int half = 1, weight = model->getSubtreeSize(vertices[0]);
+		while (half < count - 1 && 2 * weight < total)
+		{
+			weight += model->getSubtreeSize(vertices[half++]);
+		}
+
+		Join join;
+		Task task = { collectTask, this, vertices + half, count - half, &join };
+		pool->spawn(worker, task);
+		collect(vertices, half, worker);
+		pool->wait(worker, join);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the collect sweep over one large subtree. as long as only one successor has a large subtree,
+the small ones are forked and the walk goes on into the large one, so a long chain costs
+no recursion. the messages along the walk are sent on the way back up.
+
+@param	v		the root of the subtree
+@param	worker	the slot of the calling thread
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::collectPath(int v, int worker)
+{
+	Join join;
+	int u = v;
+
+	while (true)
+	{
+		View<int> next = model->getSuccessors(u);
+		int large = -1, num_of_large = 0;
+
+		for (int j = 0; j < next.getSize(); j++)
+		{
+			if (model->getSubtreeSize(next[j]) > grain)
+			{
+				large = j;
+				num_of_large++;
+			}
+		}
+		if (num_of_large != 1)
+			break;
+
+		fork(collectTask, next.begin(), large, worker, join);
+		fork(collectTask, next.begin() + large + 1, next.getSize() - large - 1, worker, join);
+		u = next[large];
+	}
+
+	View<int> next = model->getSuccessors(u);
+	collect(next.begin(), next.getSize(), worker);
+	pool->wait(worker, join);
+
+	for (; u != v; u = model->getPredecessor(u))
+	{
+		collectVertex(u, worker);
+	}
+	collectVertex(v, worker);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the distribute sweep over the subtrees below some vertices, these vertices included.
+their predecessors must have sent their messages already.
+
+@param	vertices	the roots of the subtrees, next to each other in the schedule
+@param	count		the number of subtrees
+@param	worker		the slot of the calling thread
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::distribute(const int *vertices, int count, int worker)
+{
+	int total = weigh(vertices, count);
+
+	if (total <= grain)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			for (int j = 0, size = gather(vertices[i], worker); j < size; j++)
+			{
+				distributeVertex(buffer[worker * model->getSize() + j], worker);
+			}
+		}
+	}
+	else if (count == 1)
+	{
+		distributePath(vertices[0], worker);
+	}
+	else
+	{
+		int half = 1, weight = model->getSubtreeSize(vertices[0]);
+		while (half < count - 1 && 2 * weight < total)
+		{
+			weight += model->getSubtreeSize(vertices[half++]);
+		}
+
+		Join join;
+		Task task = { distributeTask, this, vertices + half, count - half, &join };
+		pool->spawn(worker, task);
+		distribute(vertices, half, worker);
+		pool->wait(worker, join);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the distribute sweep over one large subtree, walking down the way collectPath() does.
+a vertex sends its messages before the subtrees below it are forked.
+
+@param	v		the root of the subtree
+@param	worker	the slot of the calling thread
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::distributePath(int v, int worker)
+{
+	Join join;
+	int u = v;
+
+	while (true)
+	{
+		distributeVertex(u, worker);
+
+		View<int> next = model->getSuccessors(u);
+		int large = -1, num_of_large = 0;
+
+		for (int j = 0; j < next.getSize(); j++)
+		{
+			if (model->getSubtreeSize(next[j]) > grain)
+			{
+				large = j;
+				num_of_large++;
+			}
+		}
+		if (num_of_large != 1)
+			break;
+
+		fork(distributeTask, next.begin(), large, worker, join);
+		fork(distributeTask, next.begin() + large + 1, next.getSize() - large - 1, worker, join);
+		u = next[large];
+	}
+
+	View<int> next = model->getSuccessors(u);
+	distribute(next.begin(), next.getSize(), worker);
+	pool->wait(worker, join);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the entry point of the collect tasks in the pool
+
+@param	context		the engine
+@param	vertices	the roots of the subtrees
+@param	count		the number of subtrees
+@param	worker		the slot of the thread running the task
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::collectTask(void *context, const int *vertices, int count, int worker)
+{
+	((BasicEngine *)context)->collect(vertices, count, worker);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the entry point of the distribute tasks in the pool
+
+@param	context		the engine
+@param	vertices	the roots of the subtrees
+@param	count		the number of subtrees
+@param	worker		the slot of the thread running the task
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::distributeTask(void *context, const int *vertices, int count, int worker)
+{
+	((BasicEngine *)context)->distribute(vertices, count, worker);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+lambda(x) = evidence(x) * product of the lambda messages from all the children
+
+@param	v	the dense index of the vertex
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::updateLambda(int v)
+{
+	int states = model->getCardinality(v), observed = session->getEvidence(v);
+	Accumulator *lambda = session->lambda(v);
+
+	for (int x = 0; x < states; x++)
+	{
+		lambda[x] = (Accumulator)(observed < 0 || observed == x);
+	}
+
+	View<int> edges = model->getChildEdges(v);
+	for (int j = 0; j < edges.getSize(); j++)
+	{
+		Accumulator *message = session->lambdaMessage(edges[j]);
+		for (int x = 0; x < states; x++)
+		{
+			lambda[x] *= message[x];
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+pi(x) = sum over all parent combinations u of P(x | u) * product of pi messages(u_k)
+
+@param	v		the dense index of the vertex
+@param	worker	the slot of the thread, for its scratch space
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::updatePi(int v, int worker)
+{
+	View<int> parents = model->getParents(v);
+	int first = model->getFirstEdge(v), num_of_parents = parents.getSize(), states = model->getCardinality(v);
+
+	const Accumulator *factors[ENGINE_MAX_PARENTS];
+	int radices[ENGINE_MAX_PARENTS], height = 1;
+
+	for (int k = 0; k < num_of_parents; k++)
+	{
+		factors[k] = session->piMessage(first + k);
+		radices[k] = model->getCardinality(parents[k]);
+		height *= model->getKind(v) == MODEL_NOISY_MAX || model->getKind(v) == MODEL_TREE ? 1 : radices[k];
+	}
+
+	if (model->getKind(v) == MODEL_TREE)
+		Kernel::piEvidence(model->getTree(v), states, radices, num_of_parents, factors,
+			scratch + worker * largest, session->pi(v));
+	else if (model->getKind(v) == MODEL_NOISY_MAX)
+		Kernel::piEvidence(model->getNoisy(v), states, radices, num_of_parents, factors,
+			scratch + worker * largest, session->pi(v));
+	else if (model->getKind(v) == MODEL_DENSE)
+		Kernel::piEvidence(model->getCPT(v), height, states, radices, num_of_parents, factors,
+			scratch + worker * largest, session->pi(v));
+	else
+		Kernel::piEvidence(model->getSparse(v), height, states, radices, num_of_parents, factors,
+			scratch + worker * largest, session->pi(v));
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+belief(x) = alpha * lambda(x) * pi(x)
+
+@param	v	the dense index of the vertex
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::updateBelief(int v)
+{
+	int states = model->getCardinality(v);
+	Accumulator *lambda = session->lambda(v), *pi = session->pi(v), *belief = session->belief(v);
+	Accumulator sum = 0;
+
+	for (int x = 0; x < states; x++)
+	{
+		belief[x] = lambda[x] * pi[x];
+		sum += belief[x];
+	}
+
+	Accumulator alpha = sum > 0 ? (Accumulator) 1.00 / sum : 0;
+	for (int x = 0; x < states; x++)
+	{
+		belief[x] *= alpha;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the message from the child of an edge to its parent :
+message(u) = sum over the child's states x and the other parents' states w of
+lambda(x) * P(x | u, w) * product of the other pi messages(w_k).
+the lambda of the child must be up to date.
+
+@param	e		the edge id
+@param	worker	the slot of the thread, for its scratch space
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::sendLambda(int e, int worker)
+{
+	int c = model->getEdgeChild(e);
+	View<int> parents = model->getParents(c);
+	int first = model->getFirstEdge(c), num_of_parents = parents.getSize(), slot = e - first;
+	Accumulator *message = session->lambdaMessage(e);
+
+	const Accumulator *factors[ENGINE_MAX_PARENTS];
+	int radices[ENGINE_MAX_PARENTS];
+
+	for (int k = 0; k < num_of_parents; k++)
+	{
+		factors[k] = session->piMessage(first + k);
+		radices[k] = model->getCardinality(parents[k]);
+	}
+
+	if (model->getKind(c) == MODEL_TREE)
+		Kernel::lambdaMessage(model->getTree(c), model->getCardinality(c), radices, num_of_parents, slot,
+			factors, session->lambda(c), scratch + worker * largest, message);
+	else if (model->getKind(c) == MODEL_NOISY_MAX)
+		Kernel::lambdaMessage(model->getNoisy(c), model->getCardinality(c), radices, num_of_parents, slot,
+			factors, session->lambda(c), scratch + worker * largest, message);
+	else if (model->getKind(c) == MODEL_DENSE)
+		Kernel::lambdaMessage(model->getCPT(c), model->getCardinality(c), radices, num_of_parents, slot,
+			factors, session->lambda(c), scratch + worker * largest, message);
+	else
+		Kernel::lambdaMessage(model->getSparse(c), radices, num_of_parents, slot,
+			factors, session->lambda(c), scratch + worker * largest, message);
+
+	/*rescaling does not change the posteriors but keeps long chains from underflowing*/
+	Accumulator sum = 0;
+	for (int a = radices[slot] - 1; a >= 0; a--)
+	{
+		sum += message[a];
+	}
+	if (sum > 0)
+	{
+		for (int a = radices[slot] - 1; a >= 0; a--)
+		{
+			message[a] /= sum;
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the message from the parent of an edge to its child :
+message(x) = alpha * pi(x) * evidence(x) * product of the lambda messages from the other children.
+the pi of the parent must be up to date.
+
+@param	e	the edge id
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::sendPi(int e)
+{
+	int u = model->getEdgeParent(e), states = model->getCardinality(u), observed = session->getEvidence(u);
+	Accumulator *pi = session->pi(u), *message = session->piMessage(e);
+	Accumulator sum = 0;
+
+	for (int x = 0; x < states; x++)
+	{
+		message[x] = (observed < 0 || observed == x) ? pi[x] : 0;
+	}
+
+	View<int> edges = model->getChildEdges(u);
+	for (int j = 0; j < edges.getSize(); j++)
+	{
+		if (edges[j] == e)
+			continue;
+
+		Accumulator *lambda = session->lambdaMessage(edges[j]);
+		for (int x = 0; x < states; x++)
+		{
+			message[x] *= lambda[x];
+		}
+	}
+
+	for (int x = 0; x < states; x++)
+	{
+		sum += message[x];
+	}
+	if (sum > 0)
+	{
+		for (int x = 0; x < states; x++)
+		{
+			message[x] /= sum;
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+sends the pi messages of a vertex to all its children but one. each message is the product of the
+lambda messages of the children after it, built backwards in the message itself, and of those before
+it, kept in the scratch space, so that a vertex with d children costs O(d) and not O(d^2).
+the pi of the vertex must be up to date.
+
+@param	u		the dense index of the vertex
+@param	back	the edge which gets no message, or -1
+@param	worker	the slot of the thread, for its scratch space
+*/
+template < typename Storage, typename Accumulator >
+void BasicEngine<Storage, Accumulator>::sendPi(int u, int back, int worker)
+{
+	int states = model->getCardinality(u), observed = session->getEvidence(u);
+	Accumulator *pi = session->pi(u), *prefix = scratch + worker * largest, *next = NULL, *after = NULL;
+	View<int> edges = model->getChildEdges(u);
+
+	for (int j = edges.getSize() - 1; j >= 0; j--)
+	{
+		if (edges[j] == back)
+			continue;
+
+		Accumulator *message = session->piMessage(edges[j]);
+		for (int x = 0; x < states; x++)
+		{
+			message[x] = next ? next[x] * after[x] : 1;
+		}
+		next = message;
+		after = session->lambdaMessage(edges[j]);
+	}
+
+	for (int x = 0; x < states; x++)
+	{
+		prefix[x] = (observed < 0 || observed == x) ? pi[x] : 0;
+	}
+	if (back >= 0 && model->getEdgeParent(back) == u)
+	{
+		Accumulator *lambda = session->lambdaMessage(back);
+		for (int x = 0; x < states; x++)
+		{
+			prefix[x] *= lambda[x];
+		}
+	}
+
+	for (int j = 0; j < edges.getSize(); j++)
+	{
+		if (edges[j] == back)
+			continue;
+
+		Accumulator *message = session->piMessage(edges[j]), *lambda = session->lambdaMessage(edges[j]);
+		Accumulator sum = 0;
+		for (int x = 0; x < states; x++)
+		{
+			message[x] *= prefix[x];
+			prefix[x] *= lambda[x];
+			sum += message[x];
+		}
+		if (sum > 0)
+		{
+			for (int x = 0; x < states; x++)
+			{
+				message[x] /= sum;
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v		the dense index of the vertex
+@param	state	the one-based index of the state
+@return			the posterior probability of the state after the last propagate(), or query() if v was one of its targets
+*/
+template < typename Storage, typename Accumulator >
+Accumulator BasicEngine<Storage, Accumulator>::p(int v, int state)
+{
+	if (v < 0 || v >= model->getSize() || state < 1 || state > model->getCardinality(v))
+		throw - 1;
+
+	return session->belief(v)[state - 1];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	the dense index of the vertex
+@return		all the posterior probabilities of the vertex after the last propagate(), or query() if v was one of its targets
+*/
+template < typename Storage, typename Accumulator >
+View<Accumulator> BasicEngine<Storage, Accumulator>::posterior(int v)
+{
+	return View<Accumulator>(session->belief(v), model->getCardinality(v));
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+template < typename Storage, typename Accumulator >
+BasicEngine<Storage, Accumulator>::~BasicEngine()
+{
+	if (owns_session)
+		delete session;
+	delete[] scratch;
+	delete[] buffer;
+	delete[] marks;
+	delete[] requests;
+	delete[] frames;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -5,6 +5,8 @@
 #include <string>
 #include "linkedlist.h"
 #include "bayes.h"
+#include "model.h"
+#include "cache.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -16,6 +18,14 @@ class Graph
 private:
 	string name;
 	LinkedList< Vertex * > *vertices;
+	PosteriorCache *cache;//NULL unless setCache() was called
+
+	/*the temporaries of every propagation through the vertices, so that
+	graphs used from different threads do not share an arena*/
+	Arena arena;
+
+	/*counts the changes made to the tables and links of this Graph's vertices, see getRevision()*/
+	unsigned int revision;
 
 public:
 
@@ -37,6 +47,8 @@ public:
 	/*returns number of vertices in Graph*/
 	int countVertices();
 
+	LinkedList<Vertex *> * getVertices();
+
 	string getName()
 	{
 		return this->name;
@@ -50,9 +62,23 @@ public:
 
 	void observe(Vertex *vertex, int state)
 	{
-		vertex->observe(state);
+		changeEvidence(vertex, state);
 	}
 
+	void observeAll(Vertex **vertices, int *states, int size);
+
+	void retract(Vertex *vertex);
+
+	void changeEvidence(Vertex *vertex, int state);
+
+	void setCache(int capacity);
+
+	PosteriorCache * getCache();
+
+	unsigned int getRevision();
+
+	void query(Vertex **vertices, int *states, int size, Vertex **targets, int count, float *posteriors);
+
 	void resetTable(Vertex *vertex)
 	{
 		vertex->resetTable();
@@ -70,17 +96,13 @@ public:
 
 		while (ptr)
 		{
+			ptr->data->setArena(&arena);
+			ptr->data->setRevision(&revision);
 			ptr->data->initialize();
 			ptr = ptr->next;
 		}
 
-		ptr = vertices->getHead();
-		while (ptr)
-		{
-			if (ptr->data->isRoot())
-				ptr->data->piMessage();
-			ptr = ptr->next;
-		}
+		Schedule(vertices, arena).run();
 	}
 
 	void connect(int parent, int child)
@@ -111,6 +133,11 @@ public:
 
 	void setMontyTable(Vertex*p);
 
+	template <class Storage>
+	BasicModel<Storage> * compile();
+
+	Model * compile();
+
 	~Graph();
 
 };
@@ -126,6 +153,8 @@ Graph::Graph(string name)
 {
 	vertices = new LinkedList < Vertex *>();
 	this->name = name;
+	cache = NULL;
+	revision = 0;
 }
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -133,6 +162,7 @@ Graph::Graph(string name)
 Graph::~Graph()
 {
 	delete this->vertices;
+	delete cache;
 }
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -148,6 +178,9 @@ bool Graph::addVertex(Vertex &vertex)
 	if (vertices->find(&vertex))
 		return false;
 	vertices->append(&vertex);
+	vertex.setArena(&arena);
+	vertex.setRevision(&revision);
+	revision++;
 	return true;
 }
 
@@ -164,6 +197,9 @@ bool Graph::addVertex(Vertex *vertex)
 	if (vertices->find(vertex))
 		return false;
 	vertices->append(vertex);
+	vertex->setArena(&arena);
+	vertex->setRevision(&revision);
+	revision++;
 	return true;
 }
 
@@ -183,6 +219,9 @@ bool Graph::addVertex(string name, int weight, int num_of_states)
 	if (vertices->find(v))
 		return false;
 	(this->vertices)->append(v);
+	v->setArena(&arena);
+	v->setRevision(&revision);
+	revision++;
 	return true;
 }
 
@@ -268,6 +307,16 @@ int Graph::countVertices()
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 
+/*
+@return		the vertices of the Graph, in the order they were added
+*/
+LinkedList<Vertex *> * Graph::getVertices()
+{
+	return vertices;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
 /*
 Checks if two graphs are equal
 
@@ -286,6 +335,204 @@ bool Graph::equals(const Graph *other)
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 
+/*
+observes several vertices at once. nothing is propagated yet : the messages the findings
+change are only marked stale, and computed when a posterior which needs them is read
+(Vertex::update()). nothing is changed if any of the states is out of range.
+
+@param	vertices	the vertices which are observed
+@param	states		the one-based index of the observed state of each vertex
+@param	size		the number of findings
+*/
+void Graph::observeAll(Vertex **vertices, int *states, int size)
+{
+	for (int i = 0; i < size; i++)
+	{
+		if (states[i] < 1 || states[i] > vertices[i]->getStates()->getSize())
+			throw - 1;
+	}
+
+	for (int i = 0; i < size; i++)
+	{
+		vertices[i]->setEvidence(states[i]);
+		vertices[i]->invalidate();
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+removes the observation of a vertex.
+
+only the messages leading away from the vertex depend on its evidence, so
+they are marked stale and recomputed when a posterior needing them is read.
+the messages towards it are reused as they are, which needs the graph to be
+propagated already (as it is after any initialize(), observe() or observeAll()).
+
+@param	vertex	the vertex whose observation is removed
+*/
+void Graph::retract(Vertex *vertex)
+{
+	if (!vertex->isObserved())
+		return;
+
+	vertex->clearEvidence();
+	vertex->invalidate();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+observes a different state of a vertex, or observes a vertex for the first time,
+marking only the messages leading away from it stale. please refer to
+
+void Graph::retract(Vertex *vertex)
+
+@param	vertex	the vertex
+@param	state	the one-based index of the newly observed state
+*/
+void Graph::changeEvidence(Vertex *vertex, int state)
+{
+	vertex->setEvidence(state);
+	vertex->invalidate();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+keeps the posteriors of the last queries, see query()
+
+@param	capacity	the number of sets of findings remembered, 0 drops the cache
+*/
+void Graph::setCache(int capacity)
+{
+	delete cache;
+	cache = NULL;
+	if (capacity > 0)
+		cache = new PosteriorCache(capacity);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the cache of the Graph, with its statistics, NULL if there is none
+*/
+PosteriorCache * Graph::getCache()
+{
+	return cache;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		a number which changes whenever a vertex is added to the Graph or the table of one
+			of its vertices is changed through its CPD : set, reset, resized by a new parent or
+			refilled with setTable(). a result computed from the Graph stays valid as long as
+			the revision does not change. writes made directly through getTable() are not counted.
+*/
+unsigned int Graph::getRevision()
+{
+	return revision;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the posteriors of some vertices given exactly some findings, the evidence already set on the
+Graph being ignored. with a cache (setCache()) the posteriors are looked up first, keyed by the
+set of findings and the revision of the Graph (getRevision()), and the findings are only
+set if one of them is missing. the Graph is then left with these findings, and only the messages
+leading to the targets have been computed.
+
+@param	vertices	the observed vertices
+@param	states		the one-based index of the observed state of each vertex
+@param	size		the number of findings
+@param	targets		the vertices whose posteriors are wanted
+@param	count		the number of targets
+@param	posteriors	filled with the posterior of every target, one after the other
+*/
+void Graph::query(Vertex **vertices, int *states, int size, Vertex **targets, int count, float *posteriors)
+{
+	for (int i = 0; i < size; i++)
+	{
+		if (states[i] < 1 || states[i] > vertices[i]->getStates()->getSize())
+			throw - 1;
+	}
+
+	if (cache)
+	{
+		Vector<int> ids(size);
+		for (int i = 0; i < size; i++)
+		{
+			ids[i] = vertices[i]->getId();
+		}
+		cache->select(ids.begin(), states, size, revision);
+	}
+
+	bool propagated = false;
+	for (int t = 0; t < count; t++)
+	{
+		int width = targets[t]->getStates()->getSize();
+		const float *found = cache ? cache->get(targets[t]->getId()) : NULL;
+
+		if (found)
+		{
+			memcpy(posteriors, found, width * sizeof(float));
+		}
+		else
+		{
+			if (!propagated)
+			{
+				for (Node<Vertex *> *ptr = this->vertices->getHead(); ptr; ptr = ptr->next)
+				{
+					retract(ptr->data);
+				}
+				observeAll(vertices, states, size);
+				propagated = true;
+			}
+
+			targets[t]->update();
+			int i = 0;
+			for (Node<State> *state = targets[t]->getStates()->getHead(); state; state = state->next)
+			{
+				posteriors[i++] = state->data.probability;
+			}
+			if (cache)
+				cache->put(targets[t]->getId(), posteriors, width);
+		}
+		posteriors += width;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+freezes the vertices, edges, states and CPTs of the Graph into a Model
+which the Engine runs on. changes made to the Graph later are not seen by the Model.
+throws -6 if the Graph is not a polytree, the messages of the Engine would be wrong.
+
+@return		a new Model, to be deleted by the caller
+*/
+Model * Graph::compile()
+{
+	return compile<float>();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the same, with the CPTs kept as Storage, e.g. compile<BFloat16>()
+
+@return		a new model, to be deleted by the caller
+*/
+template < typename Storage >
+BasicModel<Storage> * Graph::compile()
+{
+	return new BasicModel<Storage>(vertices);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
 
 void Graph::setMontyTable(Vertex* p)
 {
@@ -330,6 +577,7 @@ void Graph::setMontyTable(Vertex* p)
 
 
 	p->setMontyTable(monty_table);
+	initialize();
 }
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,1163 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*the instruction set is picked when compiling :
+AVX-512 if the compiler targets it (e.g. -mavx512f), then AVX2 (/arch:AVX2 or -mavx2,
+which the Release AVX2 configuration of the projects sets), otherwise plain C++*/
+#if defined(__AVX512F__)
+#define KERNEL_AVX512
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define KERNEL_AVX2
+#include <immintrin.h>
+#endif
+
+#include <cfloat>
+#include "scalar.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*a CPT with only its non-zero entries kept, row by row (CSR) :
+the entries of row r are rows[r] .. rows[r + 1] - 1 of states and values.
+a deterministic CPT, with a single 1 in every row, keeps no rows nor values
+and the entry of row r is states[r] : the state the vertex takes given that row.*/
+template <class Storage>
+struct SparseTable
+{
+	const int *rows;//height + 1 offsets, NULL if the table is deterministic
+
+	const unsigned short *states;
+
+	const Storage *values;//NULL if the table is deterministic
+};
+
+/*a noisy-MAX CPT (noisy-OR when the vertex and its parents are binary) kept as its parameters :
+P(X <= x | u) = leak(x) * product over the parents k of effect_k(x | u_k).
+state 0 of every variable is "absent" and the states above it are ordered. parameters holds
+the cumulative distributions leak(0..width-1) first, then for every parent k in turn
+radices[k] rows of width entries, effect_k(x | u) being entry x of row u. row 0 is all 1s :
+an absent parent has no effect.*/
+template <class Storage>
+struct NoisyTable
+{
+	const Storage *parameters;
+};
+
+/*a context-specific CPT kept as a decision tree over the parents, whose leaves may be shared
+by any number of contexts. nodes is laid out in preorder, the root at position 0 : a node testing
+parent k is k followed by the positions in nodes of its radices[k] children, one for every state
+of the parent, and a leaf is -1 - l, l being the row of leaves (width probabilities) it ends in.*/
+template <class Storage>
+struct TreeTable
+{
+	const int *nodes;
+	int size;//the number of entries of nodes
+
+	const Storage *leaves;
+	int num_of_leaves;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*the numeric kernels shared by the Vertex messages and the Engine.
+everything works on contiguous arrays laid out like a CPT :
+row by row, the first parent changing slowest and the states of the vertex fastest.
+no pointer has to be aligned. the CPT may be kept in another type (Storage) than the
+messages (Accumulator) : float with float and BFloat16 with float are vectorized,
+any other pair runs the plain loops.*/
+class Kernel
+{
+public:
+
+	static const char * isa();
+
+	static float dot(const float *x, const float *y, int n);
+
+	static void scale(float *y, const float *x, float s, int n);
+
+	static void multiply(float *y, const float *x, int n);
+
+	static void multiply(float *y, const float *a, const float *b, int n);
+
+	static void add(float *y, const float *x, int n);
+
+	static void axpy(float *y, float a, const float *x, int n);
+
+	static void multiplyAdd(float *y, const float *a, const float *b, int n);
+
+	static float sum(const float *x, int n);
+
+	static bool isNonNegative(const float *x, int n);
+
+	static float dot(const BFloat16 *x, const float *y, int n);
+
+	static void multiply(float *y, const BFloat16 *x, int n);
+
+	template <class Storage, class Accumulator>
+	static Accumulator dot(const Storage *x, const Accumulator *y, int n);
+
+	template <class Accumulator>
+	static void scale(Accumulator *y, const Accumulator *x, Accumulator s, int n);
+
+	template <class Storage, class Accumulator>
+	static void multiply(Accumulator *y, const Storage *x, int n);
+
+	template <class Accumulator>
+	static void add(Accumulator *y, const Accumulator *x, int n);
+
+	template <class Accumulator>
+	static int product(const Accumulator * const *factors, const int *sizes, int count, int skip,
+		const Accumulator *last, int last_size, Accumulator *z);
+
+	template <class Storage, class Accumulator>
+	static void lambdaMessage(const Storage *table, int width, const int *radices, int count, int slot,
+		const Accumulator * const *pi, const Accumulator *lambda, Accumulator *scratch, Accumulator *message);
+
+	template <class Storage, class Accumulator>
+	static void piEvidence(const Storage *table, int height, int width, const int *radices, int count,
+		const Accumulator * const *pi, Accumulator *scratch, Accumulator *evidence);
+
+	template <class Storage, class Accumulator>
+	static void lambdaMessage(const SparseTable<Storage> &table, const int *radices, int count, int slot,
+		const Accumulator * const *pi, const Accumulator *lambda, Accumulator *scratch, Accumulator *message);
+
+	template <class Storage, class Accumulator>
+	static void piEvidence(const SparseTable<Storage> &table, int height, int width, const int *radices, int count,
+		const Accumulator * const *pi, Accumulator *scratch, Accumulator *evidence);
+
+	template <class Storage, class Accumulator>
+	static void lambdaMessage(const NoisyTable<Storage> &table, int width, const int *radices, int count, int slot,
+		const Accumulator * const *pi, const Accumulator *lambda, Accumulator *scratch, Accumulator *message);
+
+	template <class Storage, class Accumulator>
+	static void piEvidence(const NoisyTable<Storage> &table, int width, const int *radices, int count,
+		const Accumulator * const *pi, Accumulator *scratch, Accumulator *evidence);
+
+	template <class Storage, class Accumulator>
+	static void lambdaMessage(const TreeTable<Storage> &table, int width, const int *radices, int count, int slot,
+		const Accumulator * const *pi, const Accumulator *lambda, Accumulator *scratch, Accumulator *message);
+
+	template <class Storage, class Accumulator>
+	static void piEvidence(const TreeTable<Storage> &table, int width, const int *radices, int count,
+		const Accumulator * const *pi, Accumulator *scratch, Accumulator *evidence);
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+@return		the name of the instruction set the kernels were compiled for
+*/
+const char * Kernel::isa()
+{
+#if defined(KERNEL_AVX512)
+	return "avx512";
+#elif defined(KERNEL_AVX2)
+	return "avx2";
+#else
+	return "scalar";
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	x	the first array
+@param	y	the second array
+@param	n	the size of both
+
+@return		the sum of x[i] * y[i]
+*/
+float Kernel::dot(const float *x, const float *y, int n)
+{
+	int i = 0;
+	float sum = 0;
+
+#if defined(KERNEL_AVX512)
+	__m512 acc = _mm512_setzero_ps();
+	for (; i + 16 <= n; i += 16)
+	{
+		acc = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), acc);
+	}
+	sum = _mm512_reduce_add_ps(acc);
+#elif defined(KERNEL_AVX2)
+	__m256 acc = _mm256_setzero_ps();
+	for (; i + 8 <= n; i += 8)
+	{
+		acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+	}
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+	half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+	half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+	sum = _mm_cvtss_f32(half);
+#endif
+
+	for (; i < n; i++)
+	{
+		sum += x[i] * y[i];
+	}
+	return sum;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+y = s * x. y may be the same array as x.
+
+@param	y	the result
+@param	x	the array to be scaled
+@param	s	the factor
+@param	n	the size of both arrays
+*/
+void Kernel::scale(float *y, const float *x, float s, int n)
+{
+	int i = 0;
+
+#if defined(KERNEL_AVX512)
+	__m512 factor = _mm512_set1_ps(s);
+	for (; i + 16 <= n; i += 16)
+	{
+		_mm512_storeu_ps(y + i, _mm512_mul_ps(_mm512_loadu_ps(x + i), factor));
+	}
+#elif defined(KERNEL_AVX2)
+	__m256 factor = _mm256_set1_ps(s);
+	for (; i + 8 <= n; i += 8)
+	{
+		_mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), factor));
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		y[i] = s * x[i];
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+y = y * x, entry by entry
+
+@param	y	the array to be multiplied, and the result
+@param	x	the other array
+@param	n	the size of both arrays
+*/
+void Kernel::multiply(float *y, const float *x, int n)
+{
+	int i = 0;
+
+#if defined(KERNEL_AVX512)
+	for (; i + 16 <= n; i += 16)
+	{
+		_mm512_storeu_ps(y + i, _mm512_mul_ps(_mm512_loadu_ps(y + i), _mm512_loadu_ps(x + i)));
+	}
+#elif defined(KERNEL_AVX2)
+	for (; i + 8 <= n; i += 8)
+	{
+		_mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(x + i)));
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		y[i] *= x[i];
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+y = a * b, entry by entry
+
+@param	y	the result
+@param	a	the first array
+@param	b	the second array
+@param	n	the size of the arrays
+*/
+void Kernel::multiply(float *y, const float *a, const float *b, int n)
+{
+	int i = 0;
+
+#if defined(KERNEL_AVX512)
+	for (; i + 16 <= n; i += 16)
+	{
+		_mm512_storeu_ps(y + i, _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+	}
+#elif defined(KERNEL_AVX2)
+	for (; i + 8 <= n; i += 8)
+	{
+		_mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		y[i] = a[i] * b[i];
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+y = y + x
+
+@param	y	the array to be added to, and the result
+@param	x	the other array
+@param	n	the size of both arrays
+*/
+void Kernel::add(float *y, const float *x, int n)
+{
+	int i = 0;
+
+#if defined(KERNEL_AVX512)
+	for (; i + 16 <= n; i += 16)
+	{
+		_mm512_storeu_ps(y + i, _mm512_add_ps(_mm512_loadu_ps(y + i), _mm512_loadu_ps(x + i)));
+	}
+#elif defined(KERNEL_AVX2)
+	for (; i + 8 <= n; i += 8)
+	{
+		_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(x + i)));
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		y[i] += x[i];
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+y = y + a * x
+
+@param	y	the array to be added to, and the result
+@param	a	the factor
+@param	x	the array to be scaled
+@param	n	the size of both arrays
+*/
+void Kernel::axpy(float *y, float a, const float *x, int n)
+{
+	int i = 0;
+
+#if defined(KERNEL_AVX512)
+	__m512 factor = _mm512_set1_ps(a);
+	for (; i + 16 <= n; i += 16)
+	{
+		_mm512_storeu_ps(y + i, _mm512_fmadd_ps(factor, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+	}
+#elif defined(KERNEL_AVX2)
+	__m256 factor = _mm256_set1_ps(a);
+	for (; i + 8 <= n; i += 8)
+	{
+		_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(factor, _mm256_loadu_ps(x + i))));
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		y[i] += a * x[i];
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+y = y + a * b, entry by entry
+
+@param	y	the array to be added to, and the result
+@param	a	the first array
+@param	b	the second array
+@param	n	the size of the arrays
+*/
+void Kernel::multiplyAdd(float *y, const float *a, const float *b, int n)
+{
+	int i = 0;
+
+#if defined(KERNEL_AVX512)
+	for (; i + 16 <= n; i += 16)
+	{
+		_mm512_storeu_ps(y + i, _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), _mm512_loadu_ps(y + i)));
+	}
+#elif defined(KERNEL_AVX2)
+	for (; i + 8 <= n; i += 8)
+	{
+		_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i))));
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		y[i] += a[i] * b[i];
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	x	the array
+@param	n	its size
+
+@return		the sum of its entries
+*/
+float Kernel::sum(const float *x, int n)
+{
+	int i = 0;
+	float sum = 0;
+
+#if defined(KERNEL_AVX512)
+	__m512 acc = _mm512_setzero_ps();
+	for (; i + 16 <= n; i += 16)
+	{
+		acc = _mm512_add_ps(acc, _mm512_loadu_ps(x + i));
+	}
+	sum = _mm512_reduce_add_ps(acc);
+#elif defined(KERNEL_AVX2)
+	__m256 acc = _mm256_setzero_ps();
+	for (; i + 8 <= n; i += 8)
+	{
+		acc = _mm256_add_ps(acc, _mm256_loadu_ps(x + i));
+	}
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+	half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+	half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+	sum = _mm_cvtss_f32(half);
+#endif
+
+	for (; i < n; i++)
+	{
+		sum += x[i];
+	}
+	return sum;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+checks a whole array without branching on every entry
+
+@param	x	the array
+@param	n	its size
+
+@return		true if every entry is finite and not negative (a NaN is neither)
+*/
+bool Kernel::isNonNegative(const float *x, int n)
+{
+	int i = 0;
+	bool valid = true;
+
+#if defined(KERNEL_AVX512)
+	__m512 zero = _mm512_setzero_ps(), largest = _mm512_set1_ps(FLT_MAX);
+	__mmask16 mask = 0xffff;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m512 v = _mm512_loadu_ps(x + i);
+		mask &= _mm512_cmp_ps_mask(v, zero, _CMP_GE_OQ) & _mm512_cmp_ps_mask(v, largest, _CMP_LE_OQ);
+	}
+	valid = mask == 0xffff;
+#elif defined(KERNEL_AVX2)
+	__m256 zero = _mm256_setzero_ps(), largest = _mm256_set1_ps(FLT_MAX);
+	__m256 mask = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256 v = _mm256_loadu_ps(x + i);
+		mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GE_OQ), _mm256_cmp_ps(v, largest, _CMP_LE_OQ)));
+	}
+	valid = _mm256_movemask_ps(mask) == 0xff;
+#endif
+
+	for (; i < n; i++)
+	{
+		valid = valid && x[i] >= 0 && x[i] <= FLT_MAX;
+	}
+	return valid;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+dot() over a CPT kept as bfloat16 : widening a bfloat16 to a float is a shift by 16 bits,
+so the vector loop costs about what the float one does while reading half the bytes.
+
+@param	x	the bfloat16 array
+@param	y	the float array
+@param	n	the size of both
+
+@return		the sum of x[i] * y[i]
+*/
+float Kernel::dot(const BFloat16 *x, const float *y, int n)
+{
+	int i = 0;
+	float sum = 0;
+
+#if defined(KERNEL_AVX512)
+	__m512 acc = _mm512_setzero_ps();
+	for (; i + 16 <= n; i += 16)
+	{
+		__m512i wide = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *)(x + i)));
+		acc = _mm512_fmadd_ps(_mm512_castsi512_ps(_mm512_slli_epi32(wide, 16)), _mm512_loadu_ps(y + i), acc);
+	}
+	sum = _mm512_reduce_add_ps(acc);
+#elif defined(KERNEL_AVX2)
+	__m256 acc = _mm256_setzero_ps();
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(x + i)));
+		acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_castsi256_ps(_mm256_slli_epi32(wide, 16)), _mm256_loadu_ps(y + i)));
+	}
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+	half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+	half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+	sum = _mm_cvtss_f32(half);
+#endif
+
+	for (; i < n; i++)
+	{
+		sum += (float)x[i] * y[i];
+	}
+	return sum;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+y = y * x, entry by entry, with x kept as bfloat16
+
+@param	y	the array to be multiplied, and the result
+@param	x	the bfloat16 array
+@param	n	the size of both arrays
+*/
+void Kernel::multiply(float *y, const BFloat16 *x, int n)
+{
+	int i = 0;
+
+#if defined(KERNEL_AVX512)
+	for (; i + 16 <= n; i += 16)
+	{
+		__m512i wide = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *)(x + i)));
+		_mm512_storeu_ps(y + i, _mm512_mul_ps(_mm512_loadu_ps(y + i), _mm512_castsi512_ps(_mm512_slli_epi32(wide, 16))));
+	}
+#elif defined(KERNEL_AVX2)
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(x + i)));
+		_mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(y + i), _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16))));
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		y[i] *= (float)x[i];
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+dot() for any other pair of types, summed up in Accumulator
+*/
+template < typename Storage, typename Accumulator >
+Accumulator Kernel::dot(const Storage *x, const Accumulator *y, int n)
+{
+	Accumulator sum = 0;
+	for (int i = 0; i < n; i++)
+	{
+		sum += Accumulator(x[i]) * y[i];
+	}
+	return sum;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+scale() for any other type
+*/
+template < typename Accumulator >
+void Kernel::scale(Accumulator *y, const Accumulator *x, Accumulator s, int n)
+{
+	for (int i = 0; i < n; i++)
+	{
+		y[i] = s * x[i];
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+multiply() for any other pair of types
+*/
+template < typename Storage, typename Accumulator >
+void Kernel::multiply(Accumulator *y, const Storage *x, int n)
+{
+	for (int i = 0; i < n; i++)
+	{
+		y[i] *= Accumulator(x[i]);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+add() for any other type
+*/
+template < typename Accumulator >
+void Kernel::add(Accumulator *y, const Accumulator *x, int n)
+{
+	for (int i = 0; i < n; i++)
+	{
+		y[i] += x[i];
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the outer product z = factors[0] x factors[1] x ... x last, leaving out factors[skip].
+the first factor changes slowest, so z has the same layout as the rows of a CPT
+whose parents have the given sizes (and as its entries, if last has the width of the CPT).
+z is built from the back, each factor turning z into sizes[k] scaled copies of itself,
+so every step is a run over contiguous memory.
+
+@param	factors		the vectors to be multiplied
+@param	sizes		the size of every factor
+@param	count		the number of factors
+@param	skip		the factor to be left out, -1 for none
+@param	last		the vector which changes fastest, NULL for a vector of ones
+@param	last_size	the size of last
+@param	z			the result, large enough for the product of all the sizes
+
+@return		the size of z
+*/
+template < typename Accumulator >
+int Kernel::product(const Accumulator * const *factors, const int *sizes, int count, int skip,
+	const Accumulator *last, int last_size, Accumulator *z)
+{
+	int size = last_size;
+
+	for (int i = 0; i < size; i++)
+	{
+		z[i] = last ? last[i] : 1;
+	}
+
+	for (int k = count - 1; k >= 0; k--)
+	{
+		if (k == skip)
+			continue;
+
+		/*the copy for d = 0 overwrites z itself, so it comes last*/
+		for (int d = sizes[k] - 1; d >= 0; d--)
+		{
+			scale(z + d * size, z, factors[k][d], size);
+		}
+		size *= sizes[k];
+	}
+
+	return size;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the message from a child to its parent number slot :
+message(u) = sum over the child's states x and the other parents' states w of
+lambda(x) * P(x | u, w) * product of the other pi messages(w_k)
+
+the other pi messages and lambda are first multiplied out into one tensor shaped like
+the CPT with the slot dimension taken out. every entry of the message is then a sum of
+dot products between that tensor and contiguous blocks of the CPT, so nothing is
+enumerated one combination at a time and nothing recurses.
+
+@param	table		the CPT of the child
+@param	width		the number of states of the child
+@param	radices		the number of states of every parent of the child
+@param	count		the number of parents of the child
+@param	slot		the zero-based index of the parent the message goes to
+@param	pi			the pi message from every parent of the child (pi[slot] is not read)
+@param	lambda		the lambda evidence of the child
+@param	scratch		room for height * width entries of the child's CPT
+@param	message		the result, radices[slot] entries (not normalized)
+*/
+template < typename Storage, typename Accumulator >
+void Kernel::lambdaMessage(const Storage *table, int width, const int *radices, int count, int slot,
+	const Accumulator * const *pi, const Accumulator *lambda, Accumulator *scratch, Accumulator *message)
+{
+	int outer = 1, inner = 1, states = radices[slot];
+
+	for (int k = 0; k < slot; k++)
+	{
+		outer *= radices[k];
+	}
+	for (int k = slot + 1; k < count; k++)
+	{
+		inner *= radices[k];
+	}
+
+	int block = inner * width;
+	product(pi, radices, count, slot, lambda, width, scratch);
+
+	for (int a = 0; a < states; a++)
+	{
+		message[a] = 0;
+	}
+
+	for (int o = 0; o < outer; o++)
+	{
+		for (int a = 0; a < states; a++)
+		{
+			message[a] += dot(table + (o * states + a) * block, scratch + o * block, block);
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the pi evidence of a vertex :
+evidence(x) = sum over all parent combinations u of P(x | u) * product of pi messages(u_k)
+
+the pi messages are multiplied out into one tensor with an entry for every entry of the CPT,
+the CPT is multiplied into it in one pass and the rows are then summed by folding the
+second half of the rows onto the first until one row is left. every step runs over
+contiguous memory, so a vertex with 5 four-state parents and 4 states costs about
+4096 multiply-adds whatever the order of its parents.
+
+@param	table		the CPT of the vertex
+@param	height		the number of rows of the CPT
+@param	width		the number of states of the vertex
+@param	radices		the number of states of every parent
+@param	count		the number of parents
+@param	pi			the pi message from every parent
+@param	scratch		room for height * width entries
+@param	evidence	the result, width entries
+*/
+template < typename Storage, typename Accumulator >
+void Kernel::piEvidence(const Storage *table, int height, int width, const int *radices, int count,
+	const Accumulator * const *pi, Accumulator *scratch, Accumulator *evidence)
+{
+	product(pi, radices, count, -1, (const Accumulator *)NULL, width, scratch);
+	multiply(scratch, table, height * width);
+
+	for (int rows = height; rows > 1;)
+	{
+		int half = rows / 2;
+		add(scratch, scratch + (rows - half) * width, half * width);
+		rows -= half;
+	}
+
+	for (int x = 0; x < width; x++)
+	{
+		evidence[x] = scratch[x];
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+lambdaMessage() over a sparse CPT. the product of the other pi messages is taken once per row
+instead of once per entry, and only the non-zero entries of the rows with a non-zero weight
+are read, so a deterministic CPT costs one multiply-add per row.
+
+@param	table		the CPT of the child
+@param	radices		the number of states of every parent of the child
+@param	count		the number of parents of the child
+@param	slot		the zero-based index of the parent the message goes to
+@param	pi			the pi message from every parent of the child (pi[slot] is not read)
+@param	lambda		the lambda evidence of the child
+@param	scratch		room for one entry per row of the child's CPT
+@param	message		the result, radices[slot] entries (not normalized)
+*/
+template < typename Storage, typename Accumulator >
+void Kernel::lambdaMessage(const SparseTable<Storage> &table, const int *radices, int count, int slot,
+	const Accumulator * const *pi, const Accumulator *lambda, Accumulator *scratch, Accumulator *message)
+{
+	int outer = 1, inner = 1, states = radices[slot];
+
+	for (int k = 0; k < slot; k++)
+	{
+		outer *= radices[k];
+	}
+	for (int k = slot + 1; k < count; k++)
+	{
+		inner *= radices[k];
+	}
+
+	product(pi, radices, count, slot, (const Accumulator *)NULL, 1, scratch);
+
+	for (int a = 0; a < states; a++)
+	{
+		message[a] = 0;
+	}
+
+	for (int o = 0, r = 0; o < outer; o++)
+	{
+		for (int a = 0; a < states; a++)
+		{
+			const Accumulator *weights = scratch + o * inner;
+			Accumulator sum = 0;
+
+			for (int i = 0; i < inner; i++, r++)
+			{
+				if (weights[i] == 0)
+					continue;
+
+				if (!table.rows)
+				{
+					sum += weights[i] * lambda[table.states[r]];
+					continue;
+				}
+
+				Accumulator row = 0;
+				for (int j = table.rows[r]; j < table.rows[r + 1]; j++)
+				{
+					row += Accumulator(table.values[j]) * lambda[table.states[j]];
+				}
+				sum += weights[i] * row;
+			}
+			message[a] += sum;
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+piEvidence() over a sparse CPT : every row is weighted by the product of the pi messages once,
+and its non-zero entries are added to the states they belong to. rows with a weight of zero
+(a parent state ruled out by the evidence) are skipped.
+
+@param	table		the CPT of the vertex
+@param	height		the number of rows of the CPT
+@param	width		the number of states of the vertex
+@param	radices		the number of states of every parent
+@param	count		the number of parents
+@param	pi			the pi message from every parent
+@param	scratch		room for height entries
+@param	evidence	the result, width entries
+*/
+template < typename Storage, typename Accumulator >
+void Kernel::piEvidence(const SparseTable<Storage> &table, int height, int width, const int *radices, int count,
+	const Accumulator * const *pi, Accumulator *scratch, Accumulator *evidence)
+{
+	product(pi, radices, count, -1, (const Accumulator *)NULL, 1, scratch);
+
+	for (int x = 0; x < width; x++)
+	{
+		evidence[x] = 0;
+	}
+
+	for (int r = 0; r < height; r++)
+	{
+		if (scratch[r] == 0)
+			continue;
+
+		if (!table.rows)
+		{
+			evidence[table.states[r]] += scratch[r];
+			continue;
+		}
+
+		for (int j = table.rows[r]; j < table.rows[r + 1]; j++)
+		{
+			evidence[table.states[j]] += scratch[r] * Accumulator(table.values[j]);
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+lambdaMessage() over a noisy-MAX CPT, in closed form :
+with G(x) = leak(x) * product over the other parents k of sum over w of pi_k(w) * effect_k(x | w),
+P(X <= x | u, the other parents) = effect_slot(x | u) * G(x), so that
+message(u) = sum over x of effect_slot(x | u) * G(x) * (lambda(x) - lambda(x + 1)).
+the cost is one pass over the parameters, whatever the number of parent combinations.
+
+@param	table		the parameters of the child
+@param	width		the number of states of the child
+@param	radices		the number of states of every parent of the child
+@param	count		the number of parents of the child
+@param	slot		the zero-based index of the parent the message goes to
+@param	pi			the pi message from every parent of the child (pi[slot] is not read)
+@param	lambda		the lambda evidence of the child
+@param	scratch		room for 2 * width entries
+@param	message		the result, radices[slot] entries (not normalized)
+*/
+template < typename Storage, typename Accumulator >
+void Kernel::lambdaMessage(const NoisyTable<Storage> &table, int width, const int *radices, int count, int slot,
+	const Accumulator * const *pi, const Accumulator *lambda, Accumulator *scratch, Accumulator *message)
+{
+	const Storage *effect = table.parameters + width, *own = effect;
+	Accumulator *cumulative = scratch, *sum = scratch + width;
+
+	for (int x = 0; x < width; x++)
+	{
+		cumulative[x] = Accumulator(table.parameters[x]);
+	}
+
+	for (int k = 0; k < count; k++)
+	{
+		if (k == slot)
+		{
+			own = effect;
+			effect += radices[k] * width;
+			continue;
+		}
+
+		for (int x = 0; x < width; x++)
+		{
+			sum[x] = 0;
+		}
+		for (int w = 0; w < radices[k]; w++, effect += width)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				sum[x] += pi[k][w] * Accumulator(effect[x]);
+			}
+		}
+		for (int x = 0; x < width; x++)
+		{
+			cumulative[x] *= sum[x];
+		}
+	}
+
+	for (int x = 0; x < width; x++)
+	{
+		cumulative[x] *= lambda[x] - (x + 1 < width ? lambda[x + 1] : 0);
+	}
+
+	for (int u = 0; u < radices[slot]; u++)
+	{
+		message[u] = dot(own + u * width, cumulative, width);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+piEvidence() over a noisy-MAX CPT, in closed form :
+P(X <= x) = leak(x) * product over the parents k of sum over u of pi_k(u) * effect_k(x | u),
+and evidence(x) = P(X <= x) - P(X <= x - 1). the cost is one pass over the parameters.
+
+@param	table		the parameters of the vertex
+@param	width		the number of states of the vertex
+@param	radices		the number of states of every parent
+@param	count		the number of parents
+@param	pi			the pi message from every parent
+@param	scratch		room for width entries
+@param	evidence	the result, width entries
+*/
+template < typename Storage, typename Accumulator >
+void Kernel::piEvidence(const NoisyTable<Storage> &table, int width, const int *radices, int count,
+	const Accumulator * const *pi, Accumulator *scratch, Accumulator *evidence)
+{
+	const Storage *effect = table.parameters + width;
+
+	for (int x = 0; x < width; x++)
+	{
+		evidence[x] = Accumulator(table.parameters[x]);
+	}
+
+	for (int k = 0; k < count; k++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			scratch[x] = 0;
+		}
+		for (int u = 0; u < radices[k]; u++, effect += width)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				scratch[x] += pi[k][u] * Accumulator(effect[x]);
+			}
+		}
+		for (int x = 0; x < width; x++)
+		{
+			evidence[x] *= scratch[x];
+		}
+	}
+
+	/*rounding must not leave a difference of two cumulative values below 0*/
+	for (int x = width - 1; x > 0; x--)
+	{
+		evidence[x] -= evidence[x - 1];
+		if (evidence[x] < 0)
+			evidence[x] = 0;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+lambdaMessage() over a tree CPT. the weight of every context, the product of the pi messages
+of the parents it tests (each one over its sum, a parent the context does not test weighing 1),
+is pushed down the tree in one pass, keeping apart the states of the parent the message goes to.
+the weights reaching every leaf are then summed up, so a leaf shared by many contexts is dotted
+with lambda once :
+message(u) = product of the sums of the other pi messages * sum over the leaves l of
+weight(l, u) * sum over x of lambda(x) * leaf_l(x).
+
+@param	table		the tree of the child
+@param	width		the number of states of the child
+@param	radices		the number of states of every parent of the child
+@param	count		the number of parents of the child
+@param	slot		the zero-based index of the parent the message goes to
+@param	pi			the pi message from every parent of the child (pi[slot] is not read)
+@param	lambda		the lambda evidence of the child
+@param	scratch		room for count + (table.size + table.num_of_leaves) * radices[slot] entries
+@param	message		the result, radices[slot] entries (not normalized)
+*/
+template < typename Storage, typename Accumulator >
+void Kernel::lambdaMessage(const TreeTable<Storage> &table, int width, const int *radices, int count, int slot,
+	const Accumulator * const *pi, const Accumulator *lambda, Accumulator *scratch, Accumulator *message)
+{
+	int states = radices[slot];
+	Accumulator *sums = scratch, *weights = scratch + count, *leaves = weights + table.size * states, total = 1;
+
+	for (int k = 0; k < count; k++)
+	{
+		sums[k] = 0;
+		for (int w = 0; k != slot && w < radices[k]; w++)
+		{
+			sums[k] += pi[k][w];
+		}
+		total *= k == slot ? 1 : sums[k];
+	}
+
+	for (int u = 0; u < states; u++)
+	{
+		message[u] = 0;
+	}
+	if (total == 0)
+		return;
+
+	for (int i = (table.size + table.num_of_leaves) * states - 1; i >= 0; i--)
+	{
+		weights[i] = 0;
+	}
+	for (int u = 0; u < states; u++)
+	{
+		weights[u] = total;
+	}
+
+	for (int i = 0; i < table.size;)
+	{
+		int k = table.nodes[i];
+		const Accumulator *weight = weights + i * states;
+
+		if (k < 0)
+		{
+			for (int u = 0; u < states; u++)
+			{
+				leaves[(-1 - k) * states + u] += weight[u];
+			}
+			i++;
+			continue;
+		}
+
+		for (int w = 0; w < radices[k]; w++)
+		{
+			Accumulator *child = weights + table.nodes[i + 1 + w] * states;
+
+			if (k == slot)
+				child[w] += weight[w];
+			else
+			{
+				Accumulator factor = pi[k][w] / sums[k];
+				for (int u = 0; u < states; u++)
+				{
+					child[u] += weight[u] * factor;
+				}
+			}
+		}
+		i += 1 + radices[k];
+	}
+
+	for (int l = 0; l < table.num_of_leaves; l++)
+	{
+		Accumulator value = dot(table.leaves + l * width, lambda, width);
+		for (int u = 0; u < states; u++)
+		{
+			message[u] += leaves[l * states + u] * value;
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+piEvidence() over a tree CPT. the weight of every context is pushed down the tree in one pass
+like in lambdaMessage(), and every leaf is then added to the evidence once, weighed by all the
+contexts which end in it.
+
+@param	table		the tree of the vertex
+@param	width		the number of states of the vertex
+@param	radices		the number of states of every parent
+@param	count		the number of parents
+@param	pi			the pi message from every parent
+@param	scratch		room for count + table.size + table.num_of_leaves entries
+@param	evidence	the result, width entries
+*/
+template < typename Storage, typename Accumulator >
+void Kernel::piEvidence(const TreeTable<Storage> &table, int width, const int *radices, int count,
+	const Accumulator * const *pi, Accumulator *scratch, Accumulator *evidence)
+{
+	Accumulator *sums = scratch, *weights = scratch + count, *leaves = weights + table.size, total = 1;
+
+	for (int k = 0; k < count; k++)
+	{
+		sums[k] = 0;
+		for (int u = 0; u < radices[k]; u++)
+		{
+			sums[k] += pi[k][u];
+		}
+		total *= sums[k];
+	}
+
+	for (int x = 0; x < width; x++)
+	{
+		evidence[x] = 0;
+	}
+	if (total == 0)
+		return;
+
+	for (int i = table.size + table.num_of_leaves - 1; i >= 0; i--)
+	{
+		weights[i] = 0;
+	}
+	weights[0] = total;
+
+	for (int i = 0; i < table.size;)
+	{
+		int k = table.nodes[i];
+
+		if (k < 0)
+		{
+			leaves[-1 - k] += weights[i];
+			i++;
+			continue;
+		}
+
+		for (int u = 0; u < radices[k]; u++)
+		{
+			weights[table.nodes[i + 1 + u]] += weights[i] * pi[k][u] / sums[k];
+		}
+		i += 1 + radices[k];
+	}
+
+	for (int l = 0; l < table.num_of_leaves; l++)
+	{
+		if (leaves[l] == 0)
+			continue;
+
+		for (int x = 0; x < width; x++)
+		{
+			evidence[x] += leaves[l] * Accumulator(table.leaves[l * width + x]);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif
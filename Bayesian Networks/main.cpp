@@ -12,16 +12,22 @@ be modeled with probabalistic graphical models such as this one.*/
 #include <string>
 #include "graph.h"
 #include "bayes.h"
+#include "static.h"
+#include "codegen.h"
 
 using namespace std;
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void testProgram();
 void montyHallProblem();
+void staticMontyHall();
+void generatedMontyHall();
 
 int main(void)
 {
 	montyHallProblem();
+	staticMontyHall();
+	generatedMontyHall();
 
 	system("PAUSE");
 	return 0;
@@ -78,6 +84,54 @@ void montyHallProblem()
 	g.displayStates(&host);
 }
 
+void staticMontyHall()
+{
+	//the same network with its shape fixed at compile time : CAR, PLAYER and HOST
+	StaticNetwork< Var<3>, Var<3>, Var<3, Parents<0, 1> > > monty;
+
+	//the host never opens the door of the car or the one the player chose
+	float host[27];
+	for (int car = 0; car < 3; car++)
+	for (int player = 0; player < 3; player++)
+	for (int door = 0; door < 3; door++)
+		host[(car * 3 + player) * 3 + door] = (door == car || door == player) ? 0.0f : (car == player ? 0.5f : 1.0f);
+	monty.setTable<2>(host, 27, false);
+
+	//player choses door 3 and the host opens door 2
+	monty.observe(1, 3);
+	monty.observe(2, 2);
+
+	cout << "\n---- STATIC MONTY HALL ----\nCAR :";
+	for (int door = 1; door <= 3; door++)
+		cout << "\t" << monty.p<0>(door);
+	cout << endl;
+}
+
+void generatedMontyHall()
+{
+	Graph g("MONTY HALL");
+	Vertex car("CAR", 0, 3);
+	Vertex player("PLAYER", 2, 3);
+	Vertex host("HOST", 7, 3);
+	g.addVertex(&car);
+	g.addVertex(&player);
+	g.addVertex(&host);
+	g.connect(&car, &host);
+	g.connect(&player, &host);
+
+	//the same CPT as above, rows by (CAR, PLAYER)
+	float table[27];
+	for (int c = 0; c < 3; c++)
+	for (int p = 0; p < 3; p++)
+	for (int door = 0; door < 3; door++)
+		table[(c * 3 + p) * 3 + door] = (door == c || door == p) ? 0.0f : (c == p ? 0.5f : 1.0f);
+	host.getCPD()->setTable(table, 27, false);
+
+	//prints the network out as the class MontyHall, to be compiled into another program
+	cout << "\n---- GENERATED MONTY HALL ----\n";
+	CodeGenerator::write(&g, "MontyHall", cout);
+}
+
 void testProgram()
 {
 	Graph g(" MY GRAPH ");
@@ -0,0 +1,150 @@
+#ifndef MAPPING_H
+#define MAPPING_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*a whole file mapped read-only into memory. the pages are loaded by the OS when they are
+first touched and shared by every process mapping the same file, so opening even a very
+large file costs next to nothing. the memory is valid until the object is deleted.*/
+class MappedFile
+{
+private:
+
+	char *data;
+
+	size_t size;
+
+#ifdef _WIN32
+	HANDLE file, mapping;
+#else
+	int descriptor;
+#endif
+
+public:
+
+	MappedFile(string path);
+
+	const char * getData();
+
+	size_t getSize();
+
+	~MappedFile();
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+maps a file
+
+@param	path	the path of the file. throws -8 if it cannot be opened or mapped, or is empty.
+*/
+MappedFile::MappedFile(string path)
+{
+	data = NULL;
+	size = 0;
+
+#ifdef _WIN32
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		throw - 8;
+
+	LARGE_INTEGER length;
+	if (!GetFileSizeEx(file, &length) || !length.QuadPart)
+	{
+		CloseHandle(file);
+		throw - 8;
+	}
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		throw - 8;
+	}
+
+	data = (char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw - 8;
+	}
+	size = (size_t)length.QuadPart;
+#else
+	descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		throw - 8;
+
+	struct stat status;
+	if (fstat(descriptor, &status) || !status.st_size)
+	{
+		close(descriptor);
+		throw - 8;
+	}
+
+	void *address = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+	if (address == MAP_FAILED)
+	{
+		close(descriptor);
+		throw - 8;
+	}
+	data = (char *)address;
+	size = (size_t)status.st_size;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the first byte of the file
+*/
+const char * MappedFile::getData()
+{
+	return data;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the size of the file in bytes
+*/
+size_t MappedFile::getSize()
+{
+	return size;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mapping);
+	CloseHandle(file);
+#else
+	munmap(data, size);
+	close(descriptor);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,1465 @@
+#ifndef MODEL_H
+#define MODEL_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <cstring>
+#include <fstream>
+#include <climits>
+#include "linkedlist.h"
+#include "vector.h"
+#include "bayes.h"
+#include "scalar.h"
+#include "mapping.h"
+#include "kernels.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*the CPT of every vertex starts on this boundary (in bytes), in memory and in a model file*/
+#define MODEL_ALIGNMENT 64
+
+/*bumped whenever the layout of a model file changes, older files are then refused*/
+#define MODEL_FILE_VERSION 4
+
+/*written as is, so a file saved on a machine of the other byte order is refused*/
+#define MODEL_FILE_BYTE_ORDER 0x01020304
+
+/*the number of sections of a model file*/
+#define MODEL_FILE_SECTIONS 33
+
+/*how the CPT of a vertex is kept, see BasicModel::getKind()*/
+#define MODEL_DENSE 0
+#define MODEL_SPARSE 1
+#define MODEL_DETERMINISTIC 2
+#define MODEL_NOISY_MAX 3
+#define MODEL_TREE 4
+
+/*a CPT with at most this share of non-zero entries is kept sparse*/
+#define MODEL_SPARSE_DENSITY 0.25f
+
+/*the first bytes of a model file. it is followed by the arrays of the Model, every one of them
+starting on a MODEL_ALIGNMENT boundary at the byte offset given in sections : the topology,
+the message layout, the schedule, the dense, the sparse, the noisy-MAX and the tree CPTs, then the offsets and the characters of the names.
+the arrays are used where they lie when the file is loaded.*/
+struct ModelFileHeader
+{
+	char magic[8];//"BNMODEL" and a zero
+	unsigned int version;
+	unsigned int byte_order;
+	unsigned int storage;//sizeof(Storage)
+	int num_of_vertices, num_of_edges, num_of_entries, num_of_roots, names_size;
+	int num_of_rows, num_of_states, num_of_values;//the sizes of the sparse CPTs
+	int num_of_parameters;//the size of the noisy-MAX CPTs
+	int num_of_nodes, num_of_leaves;//the sizes of the tree CPTs
+	long long sections[MODEL_FILE_SECTIONS];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*a frozen, read-only copy of a Graph made for inference.
+vertices are renumbered 0..n-1 in topological order (parents before children),
+the edges are stored as CSR arrays and all the CPTs live in one arena.
+a CPT which is mostly zeros, like the deterministic tables of logic gates, is kept
+sparse instead, the form being picked for every vertex from the zeros it has.
+a noisy-MAX CPD keeps its parameters only, a tree CPD its tree and its leaves.
+nothing in here points back into the Graph, so the Graph may be changed
+or destroyed once the Model has been compiled. nothing in here changes after
+the constructor either : the evidence and the messages of a query live in an
+InferenceSession, so many threads may query one Model at the same time.
+Storage is the type the CPTs are kept in : float, double or BFloat16 (see scalar.h),
+the last one halving the memory the kernels have to stream through.
+a Model may be saved to a file and loaded again with the file mapped into memory :
+the CPTs are then used in place and nothing is parsed or copied but the names.*/
+template <class Storage>
+class BasicModel
+{
+private:
+
+	int num_of_vertices, num_of_edges;
+
+	string *names;
+
+	int *cardinalities;//number of states of every vertex
+
+	/*parents of vertex v are parent_index[parent_offsets[v] .. parent_offsets[v + 1]),
+	in the same order as the vertex's CPD. the position of a parent in parent_index
+	is the id of the edge, edge_child[e] is the vertex the edge points into*/
+	int *parent_offsets;
+	int *parent_index;
+	int *edge_child;
+
+	/*children of vertex v are child_index[child_offsets[v] .. child_offsets[v + 1]),
+	child_edge holds the id of the matching edge*/
+	int *child_offsets;
+	int *child_index;
+	int *child_edge;
+
+	/*the CPT of vertex v starts at cpt + cpt_offsets[v] and is laid out
+	exactly like CPD::getTable() : row by row, last parent changing fastest*/
+	int *cpt_offsets;
+	Storage *cpt;
+
+	/*mostly zero CPTs are kept in CSR form instead (see SparseTable) :
+	the row offsets of vertex v are sparse_rows[row_offsets[v] .. row_offsets[v + 1]),
+	its states sparse_states[state_offsets[v] ..] and its values sparse_values[value_offsets[v] ..].
+	kinds[v] tells which form the CPT of v has, a dense one takes no room in the sparse arrays
+	and the other way round*/
+	int *kinds;
+	int *row_offsets;
+	int *state_offsets;
+	int *value_offsets;
+	int *sparse_rows;
+	unsigned short *sparse_states;
+	Storage *sparse_values;
+
+	/*the parameters of the noisy-MAX CPTs, those of vertex v starting at noisy[noisy_offsets[v]]
+	and laid out as NoisyTable::parameters*/
+	int *noisy_offsets;
+	Storage *noisy;
+
+	/*the tree CPTs, the nodes of vertex v starting at tree_nodes[tree_offsets[v]] and its leaves
+	at tree_leaves[leaf_offsets[v]], laid out as in TreeTable*/
+	int *tree_offsets;
+	int *tree_nodes;
+	int *leaf_offsets;
+	Storage *tree_leaves;
+
+	/*the layout of the messages of a session.
+	vertex v owns lambda, pi and belief (cardinalities[v] entries each) at vertex_offsets[v],
+	edge e owns its pi message and then its lambda message
+	(cardinality of the parent entries each) at edge_offsets[e]*/
+	int *vertex_offsets;
+	int *edge_offsets;
+
+	/*the propagation schedule : a breadth first order over the undirected polytree.
+	predecessor[v] is the vertex v was reached from (-1 for the first vertex of a tree)
+	and predecessor_edge[v] the edge between them*/
+	int *schedule;
+	int *predecessor;
+	int *predecessor_edge;
+
+	/*the vertices reached from v are schedule[successor_offsets[v] .. successor_offsets[v] + num_of_successors[v]),
+	subtree_sizes[v] counts v and everything reached through it. roots are the first vertices of the trees.*/
+	int *successor_offsets;
+	int *num_of_successors;
+	int *subtree_sizes;
+	int *roots;
+	int num_of_roots;
+
+	MappedFile *file;//the file the arrays live in if the model was loaded, NULL otherwise
+
+	BasicModel();
+
+	int getSections(void ***fields, size_t *sizes, const ModelFileHeader &header);
+
+	static bool isMonotone(const int *offsets, int n, int last);
+
+	bool isConsistent(const ModelFileHeader &header);
+
+	static int classify(CPD *table, int *nonzeros);
+
+	void sort(LinkedList<Vertex *> *vertices, Vertex **order, int *position, int num_of_ids);
+
+	void setSchedule();
+
+public:
+
+	BasicModel(LinkedList<Vertex *> *vertices);
+
+	int getSize();
+
+	int countEdges();
+
+	int find(string name);
+
+	string getName(int v);
+
+	int getCardinality(int v);
+
+	View<int> getParents(int v);
+
+	View<int> getChildren(int v);
+
+	View<int> getChildEdges(int v);
+
+	int getEdgeChild(int e);
+
+	int getEdgeParent(int e);
+
+	int getFirstEdge(int v);
+
+	Storage * getCPT(int v);
+
+	int getKind(int v);
+
+	SparseTable<Storage> getSparse(int v);
+
+	NoisyTable<Storage> getNoisy(int v);
+
+	TreeTable<Storage> getTree(int v);
+
+	int getVertexOffset(int v);
+
+	int getEdgeOffset(int e);
+
+	int getMessageSize();
+
+	View<int> getSchedule();
+
+	int getPredecessor(int v);
+
+	int getPredecessorEdge(int v);
+
+	View<int> getSuccessors(int v);
+
+	int getSubtreeSize(int v);
+
+	View<int> getRoots();
+
+	void save(string path);
+
+	static BasicModel * load(string path);
+
+	~BasicModel();
+};
+
+/*the model the Graph compiles to by default*/
+typedef BasicModel<float> Model;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+an empty model, filled in by load()
+*/
+template < typename Storage >
+BasicModel<Storage>::BasicModel()
+{
+	num_of_vertices = num_of_edges = num_of_roots = 0;
+	names = NULL;
+	cardinalities = parent_offsets = parent_index = edge_child = NULL;
+	child_offsets = child_index = child_edge = NULL;
+	cpt_offsets = vertex_offsets = edge_offsets = NULL;
+	kinds = row_offsets = state_offsets = value_offsets = sparse_rows = noisy_offsets = NULL;
+	tree_offsets = tree_nodes = leaf_offsets = NULL;
+	sparse_states = NULL;
+	sparse_values = noisy = tree_leaves = NULL;
+	schedule = predecessor = predecessor_edge = NULL;
+	successor_offsets = num_of_successors = subtree_sizes = roots = NULL;
+	cpt = NULL;
+	file = NULL;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+compiles a list of vertices into a Model
+
+@param	vertices	the vertices of the graph. every parent of a vertex must be in the list too.
+					throws -6 if they do not make a polytree (see sort()).
+*/
+template < typename Storage >
+BasicModel<Storage>::BasicModel(LinkedList<Vertex *> *vertices)
+{
+	file = NULL;
+	num_of_vertices = vertices->getSize();
+	num_of_edges = 0;
+
+	/*vertex ids are unique and small, so an array indexed by id
+	gives the dense index of a vertex in constant time*/
+	int max_id = 0;
+	for (Node<Vertex *> *ptr = vertices->getHead(); ptr; ptr = ptr->next)
+	{
+		if (ptr->data->getId() > max_id)
+			max_id = ptr->data->getId();
+		num_of_edges += ptr->data->getParents().getSize();
+	}
+
+	int *position = new int[max_id + 1];
+	Vertex **order = new Vertex *[num_of_vertices];
+	try
+	{
+		sort(vertices, order, position, max_id + 1);
+	}
+	catch (int)
+	{
+		delete[] order;
+		delete[] position;
+		throw;
+	}
+
+	names = new string[num_of_vertices];
+	cardinalities = new int[num_of_vertices];
+	parent_offsets = new int[num_of_vertices + 1];
+	child_offsets = new int[num_of_vertices + 1];
+	cpt_offsets = new int[num_of_vertices + 1];
+	vertex_offsets = new int[num_of_vertices + 1];
+	kinds = new int[num_of_vertices];
+	row_offsets = new int[num_of_vertices + 1];
+	state_offsets = new int[num_of_vertices + 1];
+	value_offsets = new int[num_of_vertices + 1];
+	noisy_offsets = new int[num_of_vertices + 1];
+	tree_offsets = new int[num_of_vertices + 1];
+	leaf_offsets = new int[num_of_vertices + 1];
+	parent_index = new int[num_of_edges];
+	edge_child = new int[num_of_edges];
+	child_index = new int[num_of_edges];
+	child_edge = new int[num_of_edges];
+	edge_offsets = new int[num_of_edges + 1];
+
+	/*the parent side of the CSR, the CPT offsets and the per-vertex message offsets.
+	every dense CPT is padded to a whole number of MODEL_ALIGNMENT blocks.*/
+	int padding = MODEL_ALIGNMENT / sizeof(Storage) > 0 ? MODEL_ALIGNMENT / sizeof(Storage) : 1;
+	parent_offsets[0] = child_offsets[0] = cpt_offsets[0] = vertex_offsets[0] = 0;
+	row_offsets[0] = state_offsets[0] = value_offsets[0] = noisy_offsets[0] = 0;
+	tree_offsets[0] = leaf_offsets[0] = 0;
+	for (int v = 0; v < num_of_vertices; v++)
+	{
+		View<Vertex *> parents = order[v]->getParents();
+		CPD *table = order[v]->getCPD();
+
+		names[v] = order[v]->getName();
+		cardinalities[v] = order[v]->getStates()->getSize();
+
+		for (int k = 0; k < parents.getSize(); k++)
+		{
+			parent_index[parent_offsets[v] + k] = position[parents[k]->getId()];
+			edge_child[parent_offsets[v] + k] = v;
+		}
+		parent_offsets[v + 1] = parent_offsets[v] + parents.getSize();
+		child_offsets[v + 1] = child_offsets[v] + order[v]->getChildren().getSize();
+		vertex_offsets[v + 1] = vertex_offsets[v] + 3 * cardinalities[v];
+
+		int nonzeros;
+		kinds[v] = classify(table, &nonzeros);
+		cpt_offsets[v + 1] = cpt_offsets[v];
+		row_offsets[v + 1] = row_offsets[v];
+		state_offsets[v + 1] = state_offsets[v];
+		value_offsets[v + 1] = value_offsets[v];
+		noisy_offsets[v + 1] = noisy_offsets[v];
+		tree_offsets[v + 1] = tree_offsets[v];
+		leaf_offsets[v + 1] = leaf_offsets[v];
+
+		if (kinds[v] == MODEL_TREE)
+		{
+			tree_offsets[v + 1] += table->getTree().size;
+			leaf_offsets[v + 1] += table->getTree().num_of_leaves * cardinalities[v];
+		}
+		else if (kinds[v] == MODEL_NOISY_MAX)
+		{
+			noisy_offsets[v + 1] += cardinalities[v];
+			for (int k = 0; k < parents.getSize(); k++)
+			{
+				noisy_offsets[v + 1] += parents[k]->getStates()->getSize() * cardinalities[v];
+			}
+		}
+		else if (kinds[v] == MODEL_DENSE)
+			cpt_offsets[v + 1] += (table->getHeight() * table->getWidth() + padding - 1) / padding * padding;
+		else if (kinds[v] == MODEL_DETERMINISTIC)
+			state_offsets[v + 1] += table->getHeight();
+		else
+		{
+			row_offsets[v + 1] += table->getHeight() + 1;
+			state_offsets[v + 1] += nonzeros;
+			value_offsets[v + 1] += nonzeros;
+		}
+	}
+
+	/*the child side of the CSR, filled by walking the edges in order*/
+	int *fill = new int[num_of_vertices];
+	for (int v = 0; v < num_of_vertices; v++)
+	{
+		fill[v] = child_offsets[v];
+	}
+	for (int e = 0; e < num_of_edges; e++)
+	{
+		int parent = parent_index[e];
+		child_index[fill[parent]] = edge_child[e];
+		child_edge[fill[parent]++] = e;
+	}
+
+	/*edge messages follow the vertex messages*/
+	edge_offsets[0] = vertex_offsets[num_of_vertices];
+	for (int e = 0; e < num_of_edges; e++)
+	{
+		edge_offsets[e + 1] = edge_offsets[e] + 2 * cardinalities[parent_index[e]];
+	}
+
+	/*aligned the way CPD::allocate() does it, the block given by new is kept just before cpt*/
+	char *raw = new char[(cpt_offsets[num_of_vertices] + 1) * sizeof(Storage) + MODEL_ALIGNMENT + sizeof(char *)];
+	size_t address = ((size_t)(raw + sizeof(char *)) + MODEL_ALIGNMENT - 1) & ~((size_t)MODEL_ALIGNMENT - 1);
+	((char **)address)[-1] = raw;
+	cpt = (Storage *)address;
+	sparse_rows = new int[row_offsets[num_of_vertices] + 1];
+	sparse_states = new unsigned short[state_offsets[num_of_vertices] + 1];
+	sparse_values = new Storage[value_offsets[num_of_vertices] + 1];
+	noisy = new Storage[noisy_offsets[num_of_vertices] + 1];
+	tree_nodes = new int[tree_offsets[num_of_vertices] + 1];
+	tree_leaves = new Storage[leaf_offsets[num_of_vertices] + 1];
+	for (int v = 0; v < num_of_vertices; v++)
+	{
+		CPD *table = order[v]->getCPD();
+
+		for (int i = noisy_offsets[v]; i < noisy_offsets[v + 1]; i++)
+		{
+			noisy[i] = Storage(table->getParameters()[i - noisy_offsets[v]]);
+		}
+		for (int i = tree_offsets[v]; i < tree_offsets[v + 1]; i++)
+		{
+			tree_nodes[i] = table->getTree().nodes[i - tree_offsets[v]];
+		}
+		for (int i = leaf_offsets[v]; i < leaf_offsets[v + 1]; i++)
+		{
+			tree_leaves[i] = Storage(table->getTree().leaves[i - leaf_offsets[v]]);
+		}
+		if (kinds[v] == MODEL_NOISY_MAX || kinds[v] == MODEL_TREE)
+			continue;
+
+		const float *entries = table->getTable();
+		int height = table->getHeight(), width = table->getWidth(), size = height * width;
+
+		for (int i = 0; i < cpt_offsets[v + 1] - cpt_offsets[v]; i++)
+		{
+			cpt[cpt_offsets[v] + i] = Storage(i < size ? entries[i] : 0.0f);
+		}
+
+		/*a deterministic row keeps the state of its 1, a sparse one every entry which is not 0*/
+		int *rows = sparse_rows + row_offsets[v], j = 0;
+		unsigned short *states = sparse_states + state_offsets[v];
+		Storage *values = sparse_values + value_offsets[v];
+
+		for (int r = 0; kinds[v] != MODEL_DENSE && r < height; r++)
+		{
+			if (kinds[v] == MODEL_SPARSE)
+				rows[r] = j;
+
+			for (int x = 0; x < width; x++)
+			{
+				if (entries[r * width + x] == 0)
+					continue;
+
+				states[j] = (unsigned short)x;
+				if (kinds[v] == MODEL_SPARSE)
+					values[j] = Storage(entries[r * width + x]);
+				j++;
+			}
+		}
+		if (kinds[v] == MODEL_SPARSE)
+			rows[height] = j;
+	}
+
+	delete[] fill;
+	delete[] order;
+	delete[] position;
+
+	setSchedule();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+orders the vertices topologically (Kahn's algorithm) so that
+every parent gets a smaller dense index than its children.
+throws -6 if the graph is not a polytree : it has a directed cycle, or
+(with a union-find over the edges) two vertices are joined by more than one path.
+
+@param	vertices	the vertices of the graph
+@param	order		filled with the vertices in topological order
+@param	position	filled with the dense index of every vertex, indexed by Vertex::getId()
+@param	num_of_ids	the size of position
+*/
+template < typename Storage >
+void BasicModel<Storage>::sort(LinkedList<Vertex *> *vertices, Vertex **order, int *position, int num_of_ids)
+{
+	int head = 0, tail = 0;
+
+	/*position first holds the number of parents not yet placed*/
+	for (Node<Vertex *> *ptr = vertices->getHead(); ptr; ptr = ptr->next)
+	{
+		position[ptr->data->getId()] = ptr->data->getParents().getSize();
+		if (!position[ptr->data->getId()])
+			order[tail++] = ptr->data;
+	}
+
+	while (head < tail)
+	{
+		Vertex *vertex = order[head];
+		View<Vertex *> children = vertex->getChildren();
+
+		for (int j = 0; j < children.getSize(); j++)
+		{
+			if (children[j]->getId() >= num_of_ids)
+				throw - 6;//a child which is not in the list
+
+			if (!--position[children[j]->getId()])
+				order[tail++] = children[j];
+		}
+		position[vertex->getId()] = head++;
+	}
+
+	if (tail != num_of_vertices)
+		throw - 6;//a cycle, or a parent which is not in the list
+
+	/*every edge has to join two trees of the undirected graph, so that
+	num_of_edges == num_of_vertices - the number of trees*/
+	int *root = new int[num_of_vertices], joined = 0;
+	for (int v = 0; v < num_of_vertices; v++)
+	{
+		root[v] = v;
+	}
+	for (int v = 0; v < num_of_vertices; v++)
+	{
+		View<Vertex *> parents = order[v]->getParents();
+		for (int k = 0; k < parents.getSize(); k++)
+		{
+			int a = position[parents[k]->getId()], b = v;
+			while (root[a] != a)
+			{
+				root[a] = root[root[a]];
+				a = root[a];
+			}
+			while (root[b] != b)
+			{
+				root[b] = root[root[b]];
+				b = root[b];
+			}
+			if (a != b)
+			{
+				root[b] = a;
+				joined++;
+			}
+		}
+	}
+	delete[] root;
+
+	if (joined != num_of_edges)
+		throw - 6;//a loop of the undirected graph
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+picks the form a CPT is kept in from the entries it has :
+deterministic if every row is a single 1 and zeros, sparse if at most MODEL_SPARSE_DENSITY
+of the entries are not 0, dense otherwise or if the vertex has too many states to be numbered
+in a SparseTable. a noisy-MAX CPD is kept as its parameters and a tree CPD as its tree.
+
+@param	table		the CPT
+@param	nonzeros	set to the number of entries which are not 0
+@return				MODEL_DENSE, MODEL_SPARSE, MODEL_DETERMINISTIC, MODEL_NOISY_MAX or MODEL_TREE
+*/
+template < typename Storage >
+int BasicModel<Storage>::classify(CPD *table, int *nonzeros)
+{
+	const float *entries = table->getTable();
+	int height = table->getHeight(), width = table->getWidth();
+	bool deterministic = true;
+
+	*nonzeros = 0;
+	if (table->getKind() == CPD_NOISY_MAX)
+		return MODEL_NOISY_MAX;
+	if (table->getKind() == CPD_TREE)
+		return MODEL_TREE;
+
+	for (int r = 0; r < height; r++)
+	{
+		int row = 0;
+		for (int x = 0; x < width; x++)
+		{
+			if (entries[r * width + x] == 0)
+				continue;
+
+			row++;
+			deterministic = deterministic && entries[r * width + x] == 1;
+		}
+		deterministic = deterministic && row == 1;
+		*nonzeros += row;
+	}
+
+	if (width > 65536)
+		return MODEL_DENSE;
+	if (deterministic)
+		return MODEL_DETERMINISTIC;
+	if (*nonzeros <= MODEL_SPARSE_DENSITY * height * width)
+		return MODEL_SPARSE;
+	return MODEL_DENSE;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+builds the breadth first schedule over the undirected polytree.
+a message sent towards a predecessor only needs messages from vertices later
+in the schedule, and a message sent away from it only needs messages from
+vertices earlier in the schedule.
+the subtrees hanging off different successors share no vertex, so their messages
+may be computed at the same time.
+*/
+template < typename Storage >
+void BasicModel<Storage>::setSchedule()
+{
+	schedule = new int[num_of_vertices];
+	predecessor = new int[num_of_vertices];
+	predecessor_edge = new int[num_of_vertices];
+	successor_offsets = new int[num_of_vertices];
+	num_of_successors = new int[num_of_vertices];
+	subtree_sizes = new int[num_of_vertices];
+	roots = new int[num_of_vertices];
+	num_of_roots = 0;
+
+	bool *visited = new bool[num_of_vertices];
+	for (int v = 0; v < num_of_vertices; v++)
+	{
+		visited[v] = false;
+	}
+
+	int head = 0, tail = 0;
+	for (int root = 0; root < num_of_vertices; root++)
+	{
+		if (visited[root])
+			continue;
+
+		visited[root] = true;
+		predecessor[root] = predecessor_edge[root] = -1;
+		roots[num_of_roots++] = root;
+		schedule[tail++] = root;
+
+		while (head < tail)
+		{
+			int v = schedule[head++];
+			successor_offsets[v] = tail;
+
+			for (int e = parent_offsets[v]; e < parent_offsets[v + 1]; e++)
+			{
+				int u = parent_index[e];
+				if (!visited[u])
+				{
+					visited[u] = true;
+					predecessor[u] = v;
+					predecessor_edge[u] = e;
+					schedule[tail++] = u;
+				}
+			}
+
+			for (int i = child_offsets[v]; i < child_offsets[v + 1]; i++)
+			{
+				int c = child_index[i];
+				if (!visited[c])
+				{
+					visited[c] = true;
+					predecessor[c] = v;
+					predecessor_edge[c] = child_edge[i];
+					schedule[tail++] = c;
+				}
+			}
+
+			num_of_successors[v] = tail - successor_offsets[v];
+		}
+	}
+
+	/*every vertex comes after its predecessor, so walking backwards sees whole subtrees*/
+	for (int v = 0; v < num_of_vertices; v++)
+	{
+		subtree_sizes[v] = 1;
+	}
+	for (int i = num_of_vertices - 1; i >= 0; i--)
+	{
+		if (predecessor[schedule[i]] >= 0)
+			subtree_sizes[predecessor[schedule[i]]] += subtree_sizes[schedule[i]];
+	}
+
+	delete[] visited;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of vertices in the model
+*/
+template < typename Storage >
+int BasicModel<Storage>::getSize()
+{
+	return num_of_vertices;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of edges in the model
+*/
+template < typename Storage >
+int BasicModel<Storage>::countEdges()
+{
+	return num_of_edges;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+finds a vertex by the name it had in the Graph
+
+@param	name	the name of the vertex
+@return			its dense index, -1 if there is no such vertex
+*/
+template < typename Storage >
+int BasicModel<Storage>::find(string name)
+{
+	for (int v = 0; v < num_of_vertices; v++)
+	{
+		if (names[v] == name)
+			return v;
+	}
+	return -1;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the name of the vertex
+*/
+template < typename Storage >
+string BasicModel<Storage>::getName(int v)
+{
+	return names[v];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the number of states of the vertex
+*/
+template < typename Storage >
+int BasicModel<Storage>::getCardinality(int v)
+{
+	return cardinalities[v];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the dense indices of the parents, in CPT order
+*/
+template < typename Storage >
+View<int> BasicModel<Storage>::getParents(int v)
+{
+	return View<int>(parent_index + parent_offsets[v], parent_offsets[v + 1] - parent_offsets[v]);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the dense indices of the children
+*/
+template < typename Storage >
+View<int> BasicModel<Storage>::getChildren(int v)
+{
+	return View<int>(child_index + child_offsets[v], child_offsets[v + 1] - child_offsets[v]);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the ids of the edges to the children, matching getChildren(v)
+*/
+template < typename Storage >
+View<int> BasicModel<Storage>::getChildEdges(int v)
+{
+	return View<int>(child_edge + child_offsets[v], child_offsets[v + 1] - child_offsets[v]);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	e	an edge id
+@return		the vertex the edge points into
+*/
+template < typename Storage >
+int BasicModel<Storage>::getEdgeChild(int e)
+{
+	return edge_child[e];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	e	an edge id
+@return		the vertex the edge comes out of
+*/
+template < typename Storage >
+int BasicModel<Storage>::getEdgeParent(int e)
+{
+	return parent_index[e];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the edges into v are getFirstEdge(v), getFirstEdge(v) + 1, ... one for every parent
+
+@param	v	a dense vertex index
+@return		the id of the edge from the first parent of v
+*/
+template < typename Storage >
+int BasicModel<Storage>::getFirstEdge(int v)
+{
+	return parent_offsets[v];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the first entry of the CPT of v, if it is dense
+*/
+template < typename Storage >
+Storage * BasicModel<Storage>::getCPT(int v)
+{
+	return cpt + cpt_offsets[v];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the form the CPT of v is kept in : MODEL_DENSE (see getCPT()), MODEL_SPARSE or MODEL_DETERMINISTIC (see getSparse())
+			MODEL_NOISY_MAX (see getNoisy()) or MODEL_TREE (see getTree())
+*/
+template < typename Storage >
+int BasicModel<Storage>::getKind(int v)
+{
+	return kinds[v];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the CPT of v, if it is sparse or deterministic
+*/
+template < typename Storage >
+SparseTable<Storage> BasicModel<Storage>::getSparse(int v)
+{
+	SparseTable<Storage> table;
+	table.rows = kinds[v] == MODEL_SPARSE ? sparse_rows + row_offsets[v] : NULL;
+	table.states = sparse_states + state_offsets[v];
+	table.values = kinds[v] == MODEL_SPARSE ? sparse_values + value_offsets[v] : NULL;
+	return table;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the parameters of the CPT of v, if it is noisy-MAX
+*/
+template < typename Storage >
+NoisyTable<Storage> BasicModel<Storage>::getNoisy(int v)
+{
+	NoisyTable<Storage> table = { noisy + noisy_offsets[v] };
+	return table;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the tree and the leaves of the CPT of v, if it is a tree
+*/
+template < typename Storage >
+TreeTable<Storage> BasicModel<Storage>::getTree(int v)
+{
+	TreeTable<Storage> table;
+	table.nodes = tree_nodes + tree_offsets[v];
+	table.size = tree_offsets[v + 1] - tree_offsets[v];
+	table.leaves = tree_leaves + leaf_offsets[v];
+	table.num_of_leaves = (leaf_offsets[v + 1] - leaf_offsets[v]) / cardinalities[v];
+	return table;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		where the lambda, pi and belief of v start in the messages of a session
+*/
+template < typename Storage >
+int BasicModel<Storage>::getVertexOffset(int v)
+{
+	return vertex_offsets[v];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	e	an edge id
+@return		where the pi and lambda message of e start in the messages of a session
+*/
+template < typename Storage >
+int BasicModel<Storage>::getEdgeOffset(int e)
+{
+	return edge_offsets[e];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of entries in the messages of a session
+*/
+template < typename Storage >
+int BasicModel<Storage>::getMessageSize()
+{
+	return edge_offsets[num_of_edges];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the breadth first propagation schedule
+*/
+template < typename Storage >
+View<int> BasicModel<Storage>::getSchedule()
+{
+	return View<int>(schedule, num_of_vertices);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the vertex v is reached from in the schedule, -1 if none
+*/
+template < typename Storage >
+int BasicModel<Storage>::getPredecessor(int v)
+{
+	return predecessor[v];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the edge between v and its predecessor, -1 if none
+*/
+template < typename Storage >
+int BasicModel<Storage>::getPredecessorEdge(int v)
+{
+	return predecessor_edge[v];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the vertices reached from v in the schedule, next to each other in it
+*/
+template < typename Storage >
+View<int> BasicModel<Storage>::getSuccessors(int v)
+{
+	return View<int>(schedule + successor_offsets[v], num_of_successors[v]);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the number of vertices in the subtree of the schedule rooted at v, v included
+*/
+template < typename Storage >
+int BasicModel<Storage>::getSubtreeSize(int v)
+{
+	return subtree_sizes[v];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the first vertex of every tree of the schedule, one per connected component
+*/
+template < typename Storage >
+View<int> BasicModel<Storage>::getRoots()
+{
+	return View<int>(roots, num_of_roots);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+lists the arrays which make up a model file, in the order of the file
+
+@param	fields			filled with the address of every array member
+@param	sizes			filled with the size of every array in bytes
+@param	header			the sizes of the CPT arena, of the sparse, of the noisy-MAX and of the tree CPTs
+@return					the number of arrays
+*/
+template < typename Storage >
+int BasicModel<Storage>::getSections(void ***fields, size_t *sizes, const ModelFileHeader &header)
+{
+	size_t n = num_of_vertices, e = num_of_edges;
+	int i = 0;
+
+	fields[i] = (void **)&cardinalities;		sizes[i++] = n * sizeof(int);
+	fields[i] = (void **)&parent_offsets;		sizes[i++] = (n + 1) * sizeof(int);
+	fields[i] = (void **)&parent_index;			sizes[i++] = e * sizeof(int);
+	fields[i] = (void **)&edge_child;			sizes[i++] = e * sizeof(int);
+	fields[i] = (void **)&child_offsets;		sizes[i++] = (n + 1) * sizeof(int);
+	fields[i] = (void **)&child_index;			sizes[i++] = e * sizeof(int);
+	fields[i] = (void **)&child_edge;			sizes[i++] = e * sizeof(int);
+	fields[i] = (void **)&cpt_offsets;			sizes[i++] = (n + 1) * sizeof(int);
+	fields[i] = (void **)&vertex_offsets;		sizes[i++] = (n + 1) * sizeof(int);
+	fields[i] = (void **)&edge_offsets;			sizes[i++] = (e + 1) * sizeof(int);
+	fields[i] = (void **)&schedule;				sizes[i++] = n * sizeof(int);
+	fields[i] = (void **)&predecessor;			sizes[i++] = n * sizeof(int);
+	fields[i] = (void **)&predecessor_edge;		sizes[i++] = n * sizeof(int);
+	fields[i] = (void **)&successor_offsets;	sizes[i++] = n * sizeof(int);
+	fields[i] = (void **)&num_of_successors;	sizes[i++] = n * sizeof(int);
+	fields[i] = (void **)&subtree_sizes;		sizes[i++] = n * sizeof(int);
+	fields[i] = (void **)&roots;				sizes[i++] = num_of_roots * sizeof(int);
+	fields[i] = (void **)&cpt;					sizes[i++] = (size_t)header.num_of_entries * sizeof(Storage);
+	fields[i] = (void **)&kinds;				sizes[i++] = n * sizeof(int);
+	fields[i] = (void **)&row_offsets;			sizes[i++] = (n + 1) * sizeof(int);
+	fields[i] = (void **)&state_offsets;		sizes[i++] = (n + 1) * sizeof(int);
+	fields[i] = (void **)&value_offsets;		sizes[i++] = (n + 1) * sizeof(int);
+	fields[i] = (void **)&sparse_rows;			sizes[i++] = (size_t)header.num_of_rows * sizeof(int);
+	fields[i] = (void **)&sparse_states;		sizes[i++] = (size_t)header.num_of_states * sizeof(unsigned short);
+	fields[i] = (void **)&sparse_values;		sizes[i++] = (size_t)header.num_of_values * sizeof(Storage);
+	fields[i] = (void **)&noisy_offsets;		sizes[i++] = (n + 1) * sizeof(int);
+	fields[i] = (void **)&noisy;				sizes[i++] = (size_t)header.num_of_parameters * sizeof(Storage);
+	fields[i] = (void **)&tree_offsets;			sizes[i++] = (n + 1) * sizeof(int);
+	fields[i] = (void **)&tree_nodes;			sizes[i++] = (size_t)header.num_of_nodes * sizeof(int);
+	fields[i] = (void **)&leaf_offsets;			sizes[i++] = (n + 1) * sizeof(int);
+	fields[i] = (void **)&tree_leaves;			sizes[i++] = (size_t)header.num_of_leaves * sizeof(Storage);
+
+	return i;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	offsets		n + 1 offsets into an array
+@param	n			the number of vertices or edges
+@param	last		the size of the array
+@return				true if the offsets start at 0, never decrease and end at last
+*/
+template < typename Storage >
+bool BasicModel<Storage>::isMonotone(const int *offsets, int n, int last)
+{
+	if (offsets[0] != 0 || offsets[n] != last)
+		return false;
+
+	for (int i = 0; i < n; i++)
+	{
+		if (offsets[i + 1] < offsets[i])
+			return false;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+checks the arrays of a loaded model against each other, so that nothing the Engine reads through
+them lies outside the file : every offset array is monotone and ends at the size of its array,
+every index names an existing vertex or edge and agrees with the other side of the CSR, the
+messages are laid out as the constructor lays them out, and every CPT has room for the cardinality
+of its vertex times the product of the cardinalities of its parents, in the form its kind says.
+the schedule has to be one setSchedule() could have built, so that the walks of the Engine along
+it end and the subtrees it hands to the workers neither overlap nor outgrow their buffers.
+
+@param	header	the sizes of the arrays
+@return			true if the model may be used
+*/
+template < typename Storage >
+bool BasicModel<Storage>::isConsistent(const ModelFileHeader &header)
+{
+	int n = num_of_vertices, e = num_of_edges;
+
+	if (num_of_roots > n || !isMonotone(parent_offsets, n, e) || !isMonotone(child_offsets, n, e)
+		|| !isMonotone(cpt_offsets, n, header.num_of_entries) || !isMonotone(row_offsets, n, header.num_of_rows)
+		|| !isMonotone(state_offsets, n, header.num_of_states) || !isMonotone(value_offsets, n, header.num_of_values)
+		|| !isMonotone(noisy_offsets, n, header.num_of_parameters) || !isMonotone(tree_offsets, n, header.num_of_nodes)
+		|| !isMonotone(leaf_offsets, n, header.num_of_leaves) || vertex_offsets[0] != 0 || edge_offsets[0] != vertex_offsets[n])
+		return false;
+
+	for (int v = 0; v < n; v++)
+	{
+		if (cardinalities[v] < 1 || cardinalities[v] > INT_MAX / 3
+			|| (long long)vertex_offsets[v] + 3 * cardinalities[v] != vertex_offsets[v + 1])
+			return false;
+	}
+
+	/*the parent side of the CSR, and the child side pointing back at the same edges*/
+	for (int v = 0; v < n; v++)
+	{
+		for (int i = parent_offsets[v]; i < parent_offsets[v + 1]; i++)
+		{
+			if (parent_index[i] < 0 || parent_index[i] >= n || edge_child[i] != v
+				|| (long long)edge_offsets[i] + 2 * cardinalities[parent_index[i]] != edge_offsets[i + 1])
+				return false;
+		}
+		for (int i = child_offsets[v]; i < child_offsets[v + 1]; i++)
+		{
+			if (child_edge[i] < 0 || child_edge[i] >= e || parent_index[child_edge[i]] != v || edge_child[child_edge[i]] != child_index[i])
+				return false;
+		}
+	}
+
+	for (int v = 0; v < n; v++)
+	{
+		int width = cardinalities[v];
+		long long height = 1;
+		for (int i = parent_offsets[v]; i < parent_offsets[v + 1]; i++)
+		{
+			height *= cardinalities[parent_index[i]];
+			if (height * width > INT_MAX)
+				return false;
+		}
+
+		int entries = cpt_offsets[v + 1] - cpt_offsets[v], rows = row_offsets[v + 1] - row_offsets[v];
+		int states = state_offsets[v + 1] - state_offsets[v], values = value_offsets[v + 1] - value_offsets[v];
+		int parameters = noisy_offsets[v + 1] - noisy_offsets[v];
+		int nodes = tree_offsets[v + 1] - tree_offsets[v], leaves = leaf_offsets[v + 1] - leaf_offsets[v];
+
+		if (kinds[v] == MODEL_DENSE)
+		{
+			if (entries < height * width)
+				return false;
+		}
+		else if (kinds[v] == MODEL_DETERMINISTIC || kinds[v] == MODEL_SPARSE)
+		{
+			const int *row = sparse_rows + row_offsets[v];
+			const unsigned short *state = sparse_states + state_offsets[v];
+
+			if (kinds[v] == MODEL_DETERMINISTIC && states != height)
+				return false;
+			if (kinds[v] == MODEL_SPARSE && (rows != height + 1 || values != states || row[0] != 0 || row[height] != states))
+				return false;
+			for (int r = 0; kinds[v] == MODEL_SPARSE && r < height; r++)
+			{
+				if (row[r + 1] < row[r])
+					return false;
+			}
+			for (int j = 0; j < states; j++)
+			{
+				if (state[j] >= width)
+					return false;
+			}
+		}
+		else if (kinds[v] == MODEL_NOISY_MAX)
+		{
+			long long size = width;
+			for (int i = parent_offsets[v]; i < parent_offsets[v + 1]; i++)
+			{
+				size += (long long)cardinalities[parent_index[i]] * width;
+			}
+			if (parameters != size)
+				return false;
+		}
+		else if (kinds[v] == MODEL_TREE)
+		{
+			/*every entry, walked from the start like the tree kernels walk it (see Kernel::piEvidence()) :
+			a leaf takes one entry and a node testing parent k is followed by radices[k] positions of its
+			children, which come after it. the walk has to end at the last entry.*/
+			if (!nodes || leaves % width)
+				return false;
+
+			const int *node = tree_nodes + tree_offsets[v];
+			int i = 0;
+			while (i < nodes)
+			{
+				if (node[i] < 0)
+				{
+					if (-1 - node[i] >= leaves / width)
+						return false;
+					i++;
+					continue;
+				}
+
+				if (node[i] >= parent_offsets[v + 1] - parent_offsets[v])
+					return false;
+				int radix = cardinalities[parent_index[parent_offsets[v] + node[i]]];
+				if (radix >= nodes - i)
+					return false;
+				for (int x = 1; x <= radix; x++)
+				{
+					if (node[i + x] <= i || node[i + x] >= nodes)
+						return false;
+				}
+				i += 1 + radix;
+			}
+		}
+		else
+			return false;
+	}
+
+	/*the schedule, walked the way setSchedule() builds it : every tree starts at its root, and the
+	successors of every vertex follow in order, each reached from it over an edge between the two.
+	every vertex is placed exactly once, so the predecessor edges span the trees and, as there are
+	no more edges than that, they are all the edges there are : the graph is a forest.*/
+	if (num_of_roots < (n > 0) || e != n - num_of_roots)
+		return false;
+
+	Vector<char> placed(n, 0);
+	int head = 0, tail = 0, root = 0;
+	while (head < n)
+	{
+		if (head == tail)
+		{
+			int r = schedule[tail];
+			if (root == num_of_roots || roots[root++] != r || r < 0 || r >= n || placed[r] || predecessor[r] != -1 || predecessor_edge[r] != -1)
+				return false;
+			placed[r] = 1;
+			tail++;
+		}
+
+		int v = schedule[head++];
+		if (successor_offsets[v] != tail || num_of_successors[v] < 0 || num_of_successors[v] > n - tail)
+			return false;
+
+		for (int j = 0; j < num_of_successors[v]; j++)
+		{
+			int u = schedule[tail++], edge = u >= 0 && u < n ? predecessor_edge[u] : -1;
+			if (edge < 0 || edge >= e || placed[u] || predecessor[u] != v
+				|| !((parent_index[edge] == v && edge_child[edge] == u) || (parent_index[edge] == u && edge_child[edge] == v)))
+				return false;
+			placed[u] = 1;
+		}
+	}
+	if (root != num_of_roots)
+		return false;
+
+	/*and every subtree is its vertex and the subtrees of its successors*/
+	for (int i = n - 1; i >= 0; i--)
+	{
+		int v = schedule[i], size = 1;
+		for (int j = successor_offsets[v]; j < successor_offsets[v] + num_of_successors[v]; j++)
+		{
+			size += subtree_sizes[schedule[j]];
+		}
+		if (subtree_sizes[v] != size)
+			return false;
+	}
+
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+writes the model to a file which load() maps back into memory. the file holds the raw arrays,
+so it may only be loaded on a machine of the same byte order and with the same Storage.
+
+@param	path	the path of the file, throws -8 if it cannot be written
+*/
+template < typename Storage >
+void BasicModel<Storage>::save(string path)
+{
+	ModelFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "BNMODEL", 8);
+	header.version = MODEL_FILE_VERSION;
+	header.byte_order = MODEL_FILE_BYTE_ORDER;
+	header.storage = sizeof(Storage);
+	header.num_of_vertices = num_of_vertices;
+	header.num_of_edges = num_of_edges;
+	header.num_of_entries = cpt_offsets[num_of_vertices];
+	header.num_of_roots = num_of_roots;
+	header.num_of_rows = row_offsets[num_of_vertices];
+	header.num_of_states = state_offsets[num_of_vertices];
+	header.num_of_values = value_offsets[num_of_vertices];
+	header.num_of_parameters = noisy_offsets[num_of_vertices];
+	header.num_of_nodes = tree_offsets[num_of_vertices];
+	header.num_of_leaves = leaf_offsets[num_of_vertices];
+
+	void **fields[MODEL_FILE_SECTIONS];
+	const void *blocks[MODEL_FILE_SECTIONS];
+	size_t sizes[MODEL_FILE_SECTIONS];
+	int count = getSections(fields, sizes, header);
+
+	for (int i = 0; i < count; i++)
+	{
+		blocks[i] = *fields[i];
+	}
+
+	/*the names go last, as offsets into one run of characters*/
+	int *name_offsets = new int[num_of_vertices + 1];
+	string characters;
+	name_offsets[0] = 0;
+	for (int v = 0; v < num_of_vertices; v++)
+	{
+		characters += names[v];
+		name_offsets[v + 1] = (int)characters.size();
+	}
+	blocks[count] = name_offsets;
+	sizes[count++] = (num_of_vertices + 1) * sizeof(int);
+	blocks[count] = characters.data();
+	sizes[count++] = characters.size();
+
+	header.names_size = (int)characters.size();
+
+	long long offset = sizeof(header);
+	for (int i = 0; i < count; i++)
+	{
+		offset = (offset + MODEL_ALIGNMENT - 1) / MODEL_ALIGNMENT * MODEL_ALIGNMENT;
+		header.sections[i] = offset;
+		offset += sizes[i];
+	}
+
+	ofstream out(path.c_str(), ios::binary);
+	char zeros[MODEL_ALIGNMENT] = { 0 };
+	offset = sizeof(header);
+	out.write((const char *)&header, sizeof(header));
+
+	for (int i = 0; i < count; i++)
+	{
+		out.write(zeros, header.sections[i] - offset);
+		out.write((const char *)blocks[i], sizes[i]);
+		offset = header.sections[i] + sizes[i];
+	}
+
+	delete[] name_offsets;
+	if (!out)
+		throw - 8;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+maps a file written by save() into memory. the topology, the schedule and the CPTs are
+used where they lie in the file, only the names are copied. loading reads the topology once to
+check it, but not the values of the CPTs, whose pages are read the first time they are used.
+
+@param	path	the path of the file. throws -8 if it cannot be mapped, is not a model file,
+				was written by another version or byte order, or with another Storage,
+				or if its arrays do not fit together (see isConsistent()).
+@return			a new model, to be deleted by the caller
+*/
+template < typename Storage >
+BasicModel<Storage> * BasicModel<Storage>::load(string path)
+{
+	MappedFile *file = new MappedFile(path);
+	const char *data = file->getData();
+	ModelFileHeader header;
+
+	if (file->getSize() < sizeof(header))
+	{
+		delete file;
+		throw - 8;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, "BNMODEL", 8) || header.version != MODEL_FILE_VERSION || header.byte_order != MODEL_FILE_BYTE_ORDER
+		|| header.storage != sizeof(Storage) || header.num_of_vertices < 0 || header.num_of_edges < 0 || header.num_of_entries < 0
+		|| header.num_of_roots < 0 || header.names_size < 0 || header.num_of_rows < 0 || header.num_of_states < 0
+		|| header.num_of_values < 0 || header.num_of_parameters < 0 || header.num_of_nodes < 0 || header.num_of_leaves < 0)
+	{
+		delete file;
+		throw - 8;
+	}
+
+	BasicModel *model = new BasicModel();
+	model->num_of_vertices = header.num_of_vertices;
+	model->num_of_edges = header.num_of_edges;
+	model->num_of_roots = header.num_of_roots;
+
+	void **fields[MODEL_FILE_SECTIONS];
+	size_t sizes[MODEL_FILE_SECTIONS];
+	int count = model->getSections(fields, sizes, header);
+	sizes[count] = (header.num_of_vertices + 1) * sizeof(int);
+	sizes[count + 1] = header.names_size;
+
+	for (int i = 0; i < count + 2; i++)
+	{
+		if (header.sections[i] < 0 || header.sections[i] % MODEL_ALIGNMENT || (size_t)header.sections[i] + sizes[i] > file->getSize())
+		{
+			delete model;
+			delete file;
+			throw - 8;
+		}
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		*fields[i] = (void *)(data + header.sections[i]);
+	}
+	model->file = file;
+
+	if (!model->isConsistent(header))
+	{
+		delete model;
+		throw - 8;
+	}
+
+	const int *name_offsets = (const int *)(data + header.sections[count]);
+	const char *characters = data + header.sections[count + 1];
+	model->names = new string[model->num_of_vertices];
+	for (int v = 0; v < model->num_of_vertices; v++)
+	{
+		if (name_offsets[v] < 0 || name_offsets[v] > name_offsets[v + 1] || name_offsets[v + 1] > header.names_size)
+		{
+			delete model;
+			throw - 8;
+		}
+		model->names[v] = string(characters + name_offsets[v], name_offsets[v + 1] - name_offsets[v]);
+	}
+
+	return model;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+template < typename Storage >
+BasicModel<Storage>::~BasicModel()
+{
+	delete[] names;
+
+	/*a loaded model's arrays belong to the file*/
+	if (file)
+	{
+		delete file;
+		return;
+	}
+
+	delete[] cardinalities;
+	delete[] parent_offsets;
+	delete[] parent_index;
+	delete[] edge_child;
+	delete[] child_offsets;
+	delete[] child_index;
+	delete[] child_edge;
+	delete[] cpt_offsets;
+	if (cpt)
+		delete[] ((char **)cpt)[-1];
+	delete[] kinds;
+	delete[] row_offsets;
+	delete[] state_offsets;
+	delete[] value_offsets;
+	delete[] sparse_rows;
+	delete[] sparse_states;
+	delete[] sparse_values;
+	delete[] noisy_offsets;
+	delete[] noisy;
+	delete[] tree_offsets;
+	delete[] tree_nodes;
+	delete[] leaf_offsets;
+	delete[] tree_leaves;
+	delete[] vertex_offsets;
+	delete[] edge_offsets;
+	delete[] schedule;
+	delete[] predecessor;
+	delete[] predecessor_edge;
+	delete[] successor_offsets;
+	delete[] num_of_successors;
+	delete[] subtree_sizes;
+	delete[] roots;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,311 @@
+#ifndef POOL_H
+#define POOL_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ThreadPool;
+
+/*counts the tasks of a fork which have not finished yet*/
+class Join
+{
+private:
+
+	atomic<int> pending;
+
+	friend class ThreadPool;
+
+public:
+
+	Join();
+
+	bool isDone();
+};
+
+/*a piece of work for the pool : function(context, items, count, worker) is called
+on some thread, worker being the slot of that thread. nothing is allocated per task.*/
+struct Task
+{
+	void(*function)(void *context, const int *items, int count, int worker);
+	void *context;
+	const int *items;
+	int count;
+	Join *join;
+};
+
+/*a fixed set of threads with one task queue each.
+a thread pushes and pops its own tasks at the back of its queue (newest first, which keeps
+its working set small) and steals from the front of the others' queues when it runs dry.
+slots 0 .. threads - 1 belong to the pool's threads, the last slot to the one outside thread
+which forks work into the pool and waits for it. a thread waiting for a Join keeps running
+tasks meanwhile, so forks may be nested as deeply as needed.*/
+class ThreadPool
+{
+private:
+
+	int threads;
+
+	thread *workers;
+
+	deque<Task> *queues;
+
+	mutex *locks;//locks[i] guards queues[i]
+
+	atomic<int> queued;//tasks sitting in any queue, idle threads sleep while it is 0
+
+	atomic<bool> stopping;
+
+	mutex sleep_lock;
+
+	condition_variable wake;
+
+	bool pop(int worker, Task &task);
+
+	bool steal(int worker, Task &task);
+
+	void execute(Task &task, int worker);
+
+	void loop(int worker);
+
+public:
+
+	ThreadPool(int threads);
+
+	int getSize();
+
+	int getCaller();
+
+	void spawn(int worker, Task task);
+
+	void wait(int worker, Join &join);
+
+	~ThreadPool();
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Join::Join()
+{
+	pending = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		true once every task spawned with this join has finished
+*/
+bool Join::isDone()
+{
+	return pending == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+starts the threads of the pool
+
+@param	threads		the number of threads besides the caller, 0 runs everything on the caller
+*/
+ThreadPool::ThreadPool(int threads)
+{
+	if (threads < 0)
+		throw - 1;
+
+	this->threads = threads;
+	queued = 0;
+	stopping = false;
+	queues = new deque<Task>[threads + 1];
+	locks = new mutex[threads + 1];
+	workers = new thread[threads + 1];
+
+	for (int i = 0; i < threads; i++)
+	{
+		workers[i] = thread(&ThreadPool::loop, this, i);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of slots, i.e. the threads of the pool and the caller
+*/
+int ThreadPool::getSize()
+{
+	return threads + 1;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the slot of the thread outside the pool which forks work into it
+*/
+int ThreadPool::getCaller()
+{
+	return threads;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+takes the newest task of a thread's own queue
+
+@param	worker	the slot of the thread
+@param	task	filled with the task
+@return			false if the queue was empty
+*/
+bool ThreadPool::pop(int worker, Task &task)
+{
+	lock_guard<mutex> guard(locks[worker]);
+
+	if (queues[worker].empty())
+		return false;
+
+	task = queues[worker].back();
+	queues[worker].pop_back();
+	queued--;
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+takes the oldest task of some other queue, trying them in turn
+
+@param	worker	the slot of the thread looking for work
+@param	task	filled with the task
+@return			false if every queue was empty
+*/
+bool ThreadPool::steal(int worker, Task &task)
+{
+	for (int i = 1; i <= threads; i++)
+	{
+		int victim = (worker + i) % (threads + 1);
+		lock_guard<mutex> guard(locks[victim]);
+
+		if (!queues[victim].empty())
+		{
+			task = queues[victim].front();
+			queues[victim].pop_front();
+			queued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+runs a task and tells its join
+
+@param	task	the task
+@param	worker	the slot of the thread running it
+*/
+void ThreadPool::execute(Task &task, int worker)
+{
+	task.function(task.context, task.items, task.count, worker);
+	task.join->pending--;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the body of every thread of the pool : run tasks, steal when out of them,
+sleep until a task is spawned when there is nothing to steal either
+
+@param	worker	the slot of the thread
+*/
+void ThreadPool::loop(int worker)
+{
+	while (!stopping)
+	{
+		Task task;
+		if (pop(worker, task) || steal(worker, task))
+		{
+			execute(task, worker);
+		}
+		else
+		{
+			unique_lock<mutex> guard(sleep_lock);
+			wake.wait(guard, [this] { return queued > 0 || stopping; });
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+queues a task on a thread's own queue, where the other threads may steal it
+
+@param	worker	the slot of the thread spawning the task
+@param	task	the task. task.join is counted up here.
+*/
+void ThreadPool::spawn(int worker, Task task)
+{
+	task.join->pending++;
+	{
+		lock_guard<mutex> guard(locks[worker]);
+		queues[worker].push_back(task);
+		queued++;
+	}
+
+	/*a sleeper checks queued under sleep_lock, so taking it here makes sure
+	the notification cannot slip in between its check and its wait*/
+	{
+		lock_guard<mutex> guard(sleep_lock);
+	}
+	wake.notify_one();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+runs tasks until every task of a join has finished
+
+@param	worker	the slot of the waiting thread
+@param	join	the join to wait for
+*/
+void ThreadPool::wait(int worker, Join &join)
+{
+	while (!join.isDone())
+	{
+		Task task;
+		if (pop(worker, task) || steal(worker, task))
+			execute(task, worker);
+		else
+			this_thread::yield();
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> guard(sleep_lock);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (int i = 0; i < threads; i++)
+	{
+		workers[i].join();
+	}
+
+	delete[] workers;
+	delete[] queues;
+	delete[] locks;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef SCALAR_H
+#define SCALAR_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*a 16 bit float made of the upper half of a float : the same range, 8 bits of mantissa
+(about 3 significant digits). good enough for the entries of a large CPT, which then
+take half the memory and half the bandwidth. it is only a storage type, arithmetic is
+done after converting to float, which costs a shift.*/
+class BFloat16
+{
+private:
+
+	unsigned short bits;
+
+public:
+
+	BFloat16();
+
+	BFloat16(float value);
+
+	operator float() const;
+
+	unsigned short getBits() const;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+Default constructor, zero
+*/
+BFloat16::BFloat16()
+{
+	bits = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+rounds a float to the nearest bfloat16, ties to even
+
+@param	value	the float
+*/
+BFloat16::BFloat16(float value)
+{
+	unsigned int x;
+	memcpy(&x, &value, sizeof(x));
+
+	if ((x & 0x7fffffff) > 0x7f800000)
+	{
+		bits = (unsigned short)((x >> 16) | 0x40);//keeps a NaN a NaN
+		return;
+	}
+
+	x += 0x7fff + ((x >> 16) & 1);
+	bits = (unsigned short)(x >> 16);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the value as a float, exactly
+*/
+BFloat16::operator float() const
+{
+	unsigned int x = (unsigned int)bits << 16;
+	float value;
+	memcpy(&value, &x, sizeof(value));
+	return value;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the raw 16 bits
+*/
+unsigned short BFloat16::getBits() const
+{
+	return bits;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,232 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "model.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*the state of one query over a compiled Model : the evidence, every message and the posteriors.
+a session only reads the Model, so one Model may serve any number of sessions at the same time,
+one per thread say, with no locks and no copies of the CPTs. the session itself is not shared.
+Accumulator is the type of the messages and the posteriors.*/
+template <class Storage, class Accumulator>
+class BasicSession
+{
+private:
+
+	BasicModel<Storage> *model;
+
+	int *evidence;//the observed state of every vertex (zero-based), -1 if unobserved
+
+	/*laid out as Model::getVertexOffset() and Model::getEdgeOffset() say :
+	lambda, pi and belief of every vertex, then the pi and lambda message of every edge*/
+	Accumulator *messages;
+
+public:
+
+	BasicSession(BasicModel<Storage> *model);
+
+	BasicModel<Storage> * getModel();
+
+	void clear();
+
+	void observe(int v, int state);
+
+	void retract(int v);
+
+	bool isObserved(int v);
+
+	int getEvidence(int v);
+
+	Accumulator * lambda(int v);
+
+	Accumulator * pi(int v);
+
+	Accumulator * belief(int v);
+
+	Accumulator * piMessage(int e);
+
+	Accumulator * lambdaMessage(int e);
+
+	~BasicSession();
+};
+
+/*the session of the default Engine*/
+typedef BasicSession<float, float> InferenceSession;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+InferenceSession class constructor, starts with no evidence
+
+@param	model	the compiled model to query. it is not copied and must outlive the session.
+*/
+template < typename Storage, typename Accumulator >
+BasicSession<Storage, Accumulator>::BasicSession(BasicModel<Storage> *model)
+{
+	this->model = model;
+	evidence = new int[model->getSize() + 1];
+	messages = new Accumulator[model->getMessageSize() + 1];
+	clear();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the model the session queries
+*/
+template < typename Storage, typename Accumulator >
+BasicModel<Storage> * BasicSession<Storage, Accumulator>::getModel()
+{
+	return model;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+removes all the evidence and sets every message to 1
+*/
+template < typename Storage, typename Accumulator >
+void BasicSession<Storage, Accumulator>::clear()
+{
+	for (int v = model->getSize() - 1; v >= 0; v--)
+	{
+		evidence[v] = -1;
+	}
+	for (int i = model->getMessageSize() - 1; i >= 0; i--)
+	{
+		messages[i] = 1;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+sets the state of a vertex as observed. nothing is propagated.
+
+@param	v		the dense index of the vertex
+@param	state	the one-based index of the observed state
+*/
+template < typename Storage, typename Accumulator >
+void BasicSession<Storage, Accumulator>::observe(int v, int state)
+{
+	if (v < 0 || v >= model->getSize() || state < 1 || state > model->getCardinality(v))
+		throw - 1;
+
+	evidence[v] = state - 1;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+removes the evidence of a vertex. nothing is propagated.
+
+@param	v	the dense index of the vertex
+*/
+template < typename Storage, typename Accumulator >
+void BasicSession<Storage, Accumulator>::retract(int v)
+{
+	if (v < 0 || v >= model->getSize())
+		throw - 1;
+
+	evidence[v] = -1;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	the dense index of the vertex
+@return		true if the vertex is observed
+*/
+template < typename Storage, typename Accumulator >
+bool BasicSession<Storage, Accumulator>::isObserved(int v)
+{
+	return evidence[v] >= 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	the dense index of the vertex
+@return		the zero-based observed state of the vertex, -1 if unobserved
+*/
+template < typename Storage, typename Accumulator >
+int BasicSession<Storage, Accumulator>::getEvidence(int v)
+{
+	return evidence[v];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the lambda evidence of v
+*/
+template < typename Storage, typename Accumulator >
+Accumulator * BasicSession<Storage, Accumulator>::lambda(int v)
+{
+	return messages + model->getVertexOffset(v);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the pi evidence of v
+*/
+template < typename Storage, typename Accumulator >
+Accumulator * BasicSession<Storage, Accumulator>::pi(int v)
+{
+	return messages + model->getVertexOffset(v) + model->getCardinality(v);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	a dense vertex index
+@return		the posterior probabilities of v
+*/
+template < typename Storage, typename Accumulator >
+Accumulator * BasicSession<Storage, Accumulator>::belief(int v)
+{
+	return messages + model->getVertexOffset(v) + 2 * model->getCardinality(v);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	e	an edge id
+@return		the message from the parent to the child of the edge
+*/
+template < typename Storage, typename Accumulator >
+Accumulator * BasicSession<Storage, Accumulator>::piMessage(int e)
+{
+	return messages + model->getEdgeOffset(e);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	e	an edge id
+@return		the message from the child to the parent of the edge
+*/
+template < typename Storage, typename Accumulator >
+Accumulator * BasicSession<Storage, Accumulator>::lambdaMessage(int e)
+{
+	return messages + model->getEdgeOffset(e) + model->getCardinality(model->getEdgeParent(e));
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+template < typename Storage, typename Accumulator >
+BasicSession<Storage, Accumulator>::~BasicSession()
+{
+	delete[] evidence;
+	delete[] messages;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,774 @@
+#ifndef STATIC_H
+#define STATIC_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include <cmath>
+#include "kernels.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*how far from 1 a row of a CPT may sum, the same as CPD_TOLERANCE*/
+#define STATIC_TOLERANCE 1e-3f
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*the zero-based indices of the parents of a Var, e.g. Parents<0, 1>*/
+template <int... Indices>
+struct Parents
+{
+	enum { count = sizeof...(Indices) };
+};
+
+/*a vertex of a StaticNetwork : its number of states and its parents, which have to come
+before it in the network*/
+template <int States, class ParentList = Parents<> >
+struct Var
+{
+	enum { states = States };
+
+	typedef ParentList parents;
+};
+
+/*a tag carrying an index, the compile-time loops of StaticNetwork overload on it*/
+template <int i>
+struct StaticIndex
+{
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*the shape of a network, worked out by the compiler. there is no constexpr in v120,
+so every value is an enum.*/
+
+/*the v-th of Vars*/
+template <int v, class Head, class... Tail>
+struct StaticAt
+{
+	typedef typename StaticAt<v - 1, Tail...>::type type;
+};
+
+template <class Head, class... Tail>
+struct StaticAt<0, Head, Tail...>
+{
+	typedef Head type;
+};
+
+/*the k-th index of a list of Parents*/
+template <int k, class ParentList>
+struct StaticParent;
+
+template <int k, int Head, int... Tail>
+struct StaticParent<k, Parents<Head, Tail...> >
+{
+	enum { value = StaticParent<k - 1, Parents<Tail...> >::value };
+};
+
+template <int Head, int... Tail>
+struct StaticParent<0, Parents<Head, Tail...> >
+{
+	enum { value = Head };
+};
+
+/*the number of rows of a CPT, the product of the states of the parents*/
+template <class ParentList, class... Vars>
+struct StaticHeight;
+
+template <class... Vars>
+struct StaticHeight<Parents<>, Vars...>
+{
+	enum { value = 1 };
+};
+
+template <int Head, int... Tail, class... Vars>
+struct StaticHeight<Parents<Head, Tail...>, Vars...>
+{
+	enum { value = StaticAt<Head, Vars...>::type::states * StaticHeight<Parents<Tail...>, Vars...>::value };
+};
+
+/*true if every parent in the list comes before vertex v*/
+template <int v, class ParentList>
+struct StaticBefore;
+
+template <int v>
+struct StaticBefore<v, Parents<> >
+{
+	enum { value = true };
+};
+
+template <int v, int Head, int... Tail>
+struct StaticBefore<v, Parents<Head, Tail...> >
+{
+	enum { value = Head >= 0 && Head < v && StaticBefore<v, Parents<Tail...> >::value };
+};
+
+/*the states of the parents of a vertex, one per parent, for the loops of the kernels*/
+template <class ParentList, class... Vars>
+struct StaticRadices;
+
+template <int... Indices, class... Vars>
+struct StaticRadices<Parents<Indices...>, Vars...>
+{
+	static const int values[sizeof...(Indices) + 1];
+};
+
+template <int... Indices, class... Vars>
+const int StaticRadices<Parents<Indices...>, Vars...>::values[sizeof...(Indices) + 1] = { StaticAt<Indices, Vars...>::type::states..., 0 };
+
+/*the sums over the first v vertices : of their states, of their CPT entries and of their parents.
+they give where the messages, the CPT and the first edge of vertex v start.*/
+template <int v, class... Vars>
+struct StaticPrefix
+{
+	typedef typename StaticAt<v - 1, Vars...>::type Last;
+
+	enum
+	{
+		states = StaticPrefix<v - 1, Vars...>::states + Last::states,
+		entries = StaticPrefix<v - 1, Vars...>::entries + Last::states * StaticHeight<typename Last::parents, Vars...>::value,
+		edges = StaticPrefix<v - 1, Vars...>::edges + Last::parents::count,
+		ordered = StaticPrefix<v - 1, Vars...>::ordered && Last::states > 0 && StaticBefore<v - 1, typename Last::parents>::value
+	};
+};
+
+template <class... Vars>
+struct StaticPrefix<0, Vars...>
+{
+	enum { states = 0, entries = 0, edges = 0, ordered = true };
+};
+
+/*edge e, counted from the first edge of vertex v on. the edges are numbered like in a Model,
+the parents of every vertex in order and the vertices in order.*/
+template <int e, int v, bool here, class... Vars>
+struct StaticEdgeFrom
+{
+	enum { rest = e - StaticAt<v, Vars...>::type::parents::count };
+
+	typedef StaticEdgeFrom<rest, v + 1, (rest < (int)StaticAt<v + 1, Vars...>::type::parents::count), Vars...> Found;
+
+	enum { child = Found::child, slot = Found::slot };
+};
+
+template <int e, int v, class... Vars>
+struct StaticEdgeFrom<e, v, true, Vars...>
+{
+	enum { child = v, slot = e };
+};
+
+/*the child, the slot (the index of the parent among those of the child) and the parent of edge e*/
+template <int e, class... Vars>
+struct StaticEdge
+{
+	typedef StaticEdgeFrom<e, 0, (e < (int)StaticAt<0, Vars...>::type::parents::count), Vars...> Found;
+
+	enum
+	{
+		child = Found::child,
+		slot = Found::slot,
+		parent = StaticParent<slot, typename StaticAt<child, Vars...>::type::parents>::value
+	};
+};
+
+/*where the messages of edge e start, one entry per state of its parent for every edge before it*/
+template <int e, class... Vars>
+struct StaticEdgeOffset
+{
+	enum { value = StaticEdgeOffset<e - 1, Vars...>::value + StaticAt<StaticEdge<e - 1, Vars...>::parent, Vars...>::type::states };
+};
+
+template <class... Vars>
+struct StaticEdgeOffset<0, Vars...>
+{
+	enum { value = 0 };
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*a polytree whose shape is fixed at compile time, for running many small networks of one
+shape fast, e.g. the Monty Hall network :
+
+	StaticNetwork< Var<3>, Var<3>, Var<3, Parents<0, 1> > > monty;
+
+the vertices are numbered in the order they are given. the sizes of the CPTs and of the
+messages and where each one lives are known to the compiler, so the kernels are loops of
+constant bounds over constant offsets, which it unrolls, and a message is found at compile
+time instead of through pointers. the network is a plain object holding every CPT, message
+and finding in arrays of its own : one on the stack allocates nothing and copying it copies
+a whole network.
+
+the messages are computed when a posterior is read, like in Vertex::update() : every message
+has a stale flag, a finding marks them all, and reading the posterior of a vertex computes the
+stale messages it depends on, each once. the recursion follows the edges away from the vertex
+read, so it is as deep as the network and no deeper.*/
+template <class... Vars>
+class StaticNetwork
+{
+public:
+
+	enum
+	{
+		size = sizeof...(Vars),
+		num_of_edges = StaticPrefix<size, Vars...>::edges,
+		num_of_states = StaticPrefix<size, Vars...>::states,
+		num_of_entries = StaticPrefix<size, Vars...>::entries,
+		num_of_messages = StaticEdgeOffset<num_of_edges, Vars...>::value
+	};
+
+	static_assert(StaticPrefix<size, Vars...>::ordered, "every Var needs states and its parents have to come before it");
+
+private:
+
+	static const int cardinalities[size];
+
+	static const int heights[size];
+
+	/*the CPT of vertex v starts at cpt[StaticPrefix<v>::entries], laid out like CPD::getTable()*/
+	float cpt[num_of_entries];
+
+	/*the pi message and the lambda message of edge e start at StaticEdgeOffset<e>::value,
+	the belief of vertex v at StaticPrefix<v>::states*/
+	float pi_messages[num_of_messages + 1];
+	float lambda_messages[num_of_messages + 1];
+	float beliefs[num_of_states];
+
+	int evidence[size];//the observed state of every vertex (zero-based), -1 if unobserved
+
+	char stale_pi[num_of_edges + 1];
+	char stale_lambda[num_of_edges + 1];
+	char stale_belief[size];
+
+	void invalidate();
+
+	template <int e>
+	bool join(int *root, StaticIndex<e>);
+
+	bool join(int *root, StaticIndex<num_of_edges>);
+
+	template <int states>
+	static void normalize(float *vector);
+
+	template <int v, int except, int e>
+	void collect(const float **factors, StaticIndex<e>);
+
+	template <int v, int except>
+	void collect(const float **factors, StaticIndex<num_of_edges>);
+
+	template <int u, int except, int e>
+	void gather(float *vector, StaticIndex<e>);
+
+	template <int u, int except>
+	void gather(float *vector, StaticIndex<num_of_edges>);
+
+	template <int v>
+	void piEvidence(float *pi, const float * const *factors);
+
+	template <int e>
+	const float * piMessage(StaticIndex<e>);
+
+	template <int e>
+	const float * lambdaMessage(StaticIndex<e>);
+
+	template <int v>
+	const float * belief();
+
+public:
+
+	StaticNetwork();
+
+	template <int v>
+	void setTable(const float *values, int size, bool normalize);
+
+	void observe(int v, int state);
+
+	void retract(int v);
+
+	void clear();
+
+	bool isObserved(int v);
+
+	template <int v>
+	float p(int state);
+
+	template <int v>
+	void posterior(float *probabilities);
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <class... Vars>
+const int StaticNetwork<Vars...>::cardinalities[StaticNetwork<Vars...>::size] = { Vars::states... };
+
+template <class... Vars>
+const int StaticNetwork<Vars...>::heights[StaticNetwork<Vars...>::size] = { StaticHeight<typename Vars::parents, Vars...>::value... };
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+StaticNetwork class constructor.
+every CPT starts uniform and nothing is observed.
+throws -1 if the network is not a polytree (two vertices joined by more than one path).
+*/
+template <class... Vars>
+StaticNetwork<Vars...>::StaticNetwork()
+{
+	int root[size];
+	for (int v = 0; v < size; v++)
+	{
+		root[v] = v;
+	}
+	if (!join(root, StaticIndex<0>()))
+		throw - 1;
+
+	for (int v = 0, j = 0; v < size; v++)
+	{
+		for (int i = cardinalities[v] * heights[v]; i > 0; i--)
+		{
+			cpt[j++] = 1.00f / cardinalities[v];
+		}
+	}
+
+	clear();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the parents come before their children, so a union-find over the edges in order finds a cycle
+of the undirected graph as an edge joining two vertices which are joined already.
+
+@param	root	the union-find forest, every vertex its own tree to start with
+@return			false if edge e or one after it closes a cycle
+*/
+template <class... Vars>
+template <int e>
+bool StaticNetwork<Vars...>::join(int *root, StaticIndex<e>)
+{
+	int a = StaticEdge<e, Vars...>::parent, b = StaticEdge<e, Vars...>::child;
+	while (root[a] != a)
+	{
+		a = root[a];
+	}
+	while (root[b] != b)
+	{
+		b = root[b];
+	}
+	if (a == b)
+		return false;
+
+	root[b] = a;
+	return join(root, StaticIndex<e + 1>());
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+template <class... Vars>
+bool StaticNetwork<Vars...>::join(int *, StaticIndex<num_of_edges>)
+{
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+marks every message and every posterior out of date
+*/
+template <class... Vars>
+void StaticNetwork<Vars...>::invalidate()
+{
+	memset(stale_pi, 1, sizeof(stale_pi));
+	memset(stale_lambda, 1, sizeof(stale_lambda));
+	memset(stale_belief, 1, sizeof(stale_belief));
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+scales a vector to sum to 1, leaves it at 0 if it sums to 0 (after impossible findings)
+
+@param	vector	states values
+*/
+template <class... Vars>
+template <int states>
+void StaticNetwork<Vars...>::normalize(float *vector)
+{
+	float sum = 0;
+	for (int x = 0; x < states; x++)
+	{
+		sum += vector[x];
+	}
+
+	float alpha = sum > 0 ? 1.00f / sum : 0;
+	for (int x = 0; x < states; x++)
+	{
+		vector[x] *= alpha;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the pi messages coming into vertex v, from edge e on. the loop runs over every edge and keeps
+those of v, the test is on constants so only they are left once it is unrolled.
+
+@param	factors	set to the message of the parent in every slot
+@param	except	an edge whose message is left out, -1 for none
+*/
+template <class... Vars>
+template <int v, int except, int e>
+void StaticNetwork<Vars...>::collect(const float **factors, StaticIndex<e>)
+{
+	if (StaticEdge<e, Vars...>::child == v && e != except)
+		factors[StaticEdge<e, Vars...>::slot] = piMessage(StaticIndex<e>());
+
+	collect<v, except>(factors, StaticIndex<e + 1>());
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+template <class... Vars>
+template <int v, int except>
+void StaticNetwork<Vars...>::collect(const float **, StaticIndex<num_of_edges>)
+{
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+multiplies the lambda messages coming into vertex u from its children, from edge e on,
+into a vector. the edges are walked like in collect().
+
+@param	vector	one value per state of u
+@param	except	an edge whose message is left out, -1 for none
+*/
+template <class... Vars>
+template <int u, int except, int e>
+void StaticNetwork<Vars...>::gather(float *vector, StaticIndex<e>)
+{
+	if (StaticEdge<e, Vars...>::parent == u && e != except)
+	{
+		const float *message = lambdaMessage(StaticIndex<e>());
+		for (int x = 0; x < StaticAt<u, Vars...>::type::states; x++)
+		{
+			vector[x] *= message[x];
+		}
+	}
+
+	gather<u, except>(vector, StaticIndex<e + 1>());
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+template <class... Vars>
+template <int u, int except>
+void StaticNetwork<Vars...>::gather(float *, StaticIndex<num_of_edges>)
+{
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+pi(x) = sum over all parent combinations u of P(x | u) * product of pi messages(u_k)
+
+the digits of a row are peeled off from the last parent, whose states are next to each other,
+to the first. every bound is a constant, so the loops unroll to a sum of products.
+
+@param	pi		the result, one value per state of v
+@param	factors	the pi message of every parent
+*/
+template <class... Vars>
+template <int v>
+void StaticNetwork<Vars...>::piEvidence(float *pi, const float * const *factors)
+{
+	typedef typename StaticAt<v, Vars...>::type Vertex;
+	enum { states = Vertex::states, count = Vertex::parents::count, height = StaticHeight<typename Vertex::parents, Vars...>::value };
+	const int *radices = StaticRadices<typename Vertex::parents, Vars...>::values;
+	const float *table = cpt + StaticPrefix<v, Vars...>::entries;
+
+	for (int x = 0; x < states; x++)
+	{
+		pi[x] = 0;
+	}
+
+	for (int r = 0; r < height; r++)
+	{
+		float weight = 1;
+		for (int k = count - 1, rest = r; k >= 0; k--)
+		{
+			weight *= factors[k][rest % radices[k]];
+			rest /= radices[k];
+		}
+
+		for (int x = 0; x < states; x++)
+		{
+			pi[x] += weight * table[r * states + x];
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the message from the parent of edge e to its child :
+message(x) = alpha * pi(x) * evidence(x) * product of the lambda messages from the other children
+
+@return	the message, computed if it is stale
+*/
+template <class... Vars>
+template <int e>
+const float * StaticNetwork<Vars...>::piMessage(StaticIndex<e>)
+{
+	enum { u = StaticEdge<e, Vars...>::parent, states = StaticAt<u, Vars...>::type::states };
+	float *message = pi_messages + StaticEdgeOffset<e, Vars...>::value;
+
+	if (!stale_pi[e])
+		return message;
+
+	const float *factors[StaticAt<u, Vars...>::type::parents::count + 1];
+	collect<u, -1>(factors, StaticIndex<0>());
+	piEvidence<u>(message, factors);
+
+	for (int x = 0; x < states; x++)
+	{
+		if (evidence[u] >= 0 && evidence[u] != x)
+			message[x] = 0;
+	}
+	gather<u, e>(message, StaticIndex<0>());
+	normalize<states>(message);
+
+	stale_pi[e] = 0;
+	return message;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+the message from the child of edge e to its parent :
+message(u) = sum over the child's states x and the other parents' states w of
+lambda(x) * P(x | u, w) * product of the other pi messages(w_k)
+
+@return	the message, computed if it is stale
+*/
+template <class... Vars>
+template <int e>
+const float * StaticNetwork<Vars...>::lambdaMessage(StaticIndex<e>)
+{
+	enum { c = StaticEdge<e, Vars...>::child, slot = StaticEdge<e, Vars...>::slot, u = StaticEdge<e, Vars...>::parent };
+	typedef typename StaticAt<c, Vars...>::type Vertex;
+	enum { states = Vertex::states, count = Vertex::parents::count, height = StaticHeight<typename Vertex::parents, Vars...>::value };
+	const int *radices = StaticRadices<typename Vertex::parents, Vars...>::values;
+	const float *table = cpt + StaticPrefix<c, Vars...>::entries;
+	float *message = lambda_messages + StaticEdgeOffset<e, Vars...>::value;
+
+	if (!stale_lambda[e])
+		return message;
+
+	float lambda[states];
+	for (int x = 0; x < states; x++)
+	{
+		lambda[x] = evidence[c] < 0 || evidence[c] == x ? 1.00f : 0.00f;
+	}
+	gather<c, -1>(lambda, StaticIndex<0>());
+
+	const float *factors[count + 1];
+	collect<c, e>(factors, StaticIndex<0>());
+
+	for (int a = 0; a < StaticAt<u, Vars...>::type::states; a++)
+	{
+		message[a] = 0;
+	}
+
+	for (int r = 0; r < height; r++)
+	{
+		float weight = 1, dot = 0;
+		int digit = 0;
+		for (int k = count - 1, rest = r; k >= 0; k--)
+		{
+			if (k == slot)
+				digit = rest % radices[k];
+			else
+				weight *= factors[k][rest % radices[k]];
+			rest /= radices[k];
+		}
+
+		for (int x = 0; x < states; x++)
+		{
+			dot += table[r * states + x] * lambda[x];
+		}
+		message[digit] += weight * dot;
+	}
+
+	/*rescaling does not change the posteriors but keeps long chains from underflowing*/
+	normalize<StaticAt<u, Vars...>::type::states>(message);
+
+	stale_lambda[e] = 0;
+	return message;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+belief(x) = alpha * lambda(x) * pi(x)
+
+@return	the posterior probabilities of vertex v, computed if they are stale
+*/
+template <class... Vars>
+template <int v>
+const float * StaticNetwork<Vars...>::belief()
+{
+	typedef typename StaticAt<v, Vars...>::type Vertex;
+	enum { states = Vertex::states };
+	float *belief = beliefs + StaticPrefix<v, Vars...>::states;
+
+	if (!stale_belief[v])
+		return belief;
+
+	const float *factors[Vertex::parents::count + 1];
+	collect<v, -1>(factors, StaticIndex<0>());
+	piEvidence<v>(belief, factors);
+
+	for (int x = 0; x < states; x++)
+	{
+		if (evidence[v] >= 0 && evidence[v] != x)
+			belief[x] = 0;
+	}
+	gather<v, -1>(belief, StaticIndex<0>());
+	normalize<states>(belief);
+
+	stale_belief[v] = 0;
+	return belief;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+copies the CPT of vertex v, laid out like CPD::setTable() : one row per combination of the
+parents (the first parent changing slowest, the last fastest) and the states of the vertex
+contiguous within a row.
+
+@param	values		StaticHeight * states values
+@param	size		the number of values, throws -1 if it is not the size of the table or if the values
+					are not valid (every entry not negative and every row summing to 1, to STATIC_TOLERANCE,
+					or to more than 0 if normalized). the table is then left as it was.
+@param	normalize	true to scale every row so that it sums to 1
+*/
+template <class... Vars>
+template <int v>
+void StaticNetwork<Vars...>::setTable(const float *values, int size, bool normalize)
+{
+	typedef typename StaticAt<v, Vars...>::type Vertex;
+	enum { states = Vertex::states, height = StaticHeight<typename Vertex::parents, Vars...>::value };
+	float *table = cpt + StaticPrefix<v, Vars...>::entries;
+
+	if (size != states * height || !values || !Kernel::isNonNegative(values, size))
+		throw - 1;
+
+	for (int r = 0; r < height; r++)
+	{
+		float sum = Kernel::sum(values + r * states, states);
+		if (normalize ? !(sum > 0) : fabs(sum - 1.00f) > STATIC_TOLERANCE)
+			throw - 1;
+	}
+
+	for (int r = 0; r < height; r++)
+	{
+		float sum = normalize ? Kernel::sum(values + r * states, states) : 1.00f;
+		Kernel::scale(table + r * states, values + r * states, 1.00f / sum, states);
+	}
+
+	invalidate();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+sets the state of a vertex as observed. nothing is computed until a posterior is read.
+
+@param	v		the zero-based index of the vertex
+@param	state	the one-based index of the observed state, throws -1 if either is out of range
+*/
+template <class... Vars>
+void StaticNetwork<Vars...>::observe(int v, int state)
+{
+	if (v < 0 || v >= size || state < 1 || state > cardinalities[v])
+		throw - 1;
+
+	evidence[v] = state - 1;
+	invalidate();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+removes the evidence of a vertex
+
+@param	v	the zero-based index of the vertex, throws -1 if it is out of range
+*/
+template <class... Vars>
+void StaticNetwork<Vars...>::retract(int v)
+{
+	if (v < 0 || v >= size)
+		throw - 1;
+
+	evidence[v] = -1;
+	invalidate();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+removes every finding
+*/
+template <class... Vars>
+void StaticNetwork<Vars...>::clear()
+{
+	for (int v = 0; v < size; v++)
+	{
+		evidence[v] = -1;
+	}
+	invalidate();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	v	the zero-based index of the vertex
+@return		true if the vertex is observed
+*/
+template <class... Vars>
+bool StaticNetwork<Vars...>::isObserved(int v)
+{
+	return v >= 0 && v < size && evidence[v] >= 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	state	the one-based index of a state of vertex v, throws -1 if it is out of range
+@return			its posterior probability given the findings
+*/
+template <class... Vars>
+template <int v>
+float StaticNetwork<Vars...>::p(int state)
+{
+	if (state < 1 || state > StaticAt<v, Vars...>::type::states)
+		throw - 1;
+
+	return belief<v>()[state - 1];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	probabilities	filled with the posterior probability of every state of vertex v
+*/
+template <class... Vars>
+template <int v>
+void StaticNetwork<Vars...>::posterior(float *probabilities)
+{
+	memcpy(probabilities, belief<v>(), StaticAt<v, Vars...>::type::states * sizeof(float));
+}
+
+#endif
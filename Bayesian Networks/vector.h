@@ -97,7 +97,7 @@ template < typename T >
 Vector<T>::Vector(unsigned int size)
 {
 	this->size = size;
-	Log = ceil(log((double)size) / log(2.0));
+	Log = size > 1 ? (unsigned int) ceil(log((double)size) / log(2.0)) : 0;//log(0) is -inf
 	capacity = 1 << Log;
 	arr = new T[capacity];
 }
@@ -117,7 +117,7 @@ template < typename T >
 Vector<T>::Vector(unsigned int size, const T &initial)
 {
 	this->size = size;
-	Log = ceil(log((double)size) / log(2.0));
+	Log = size > 1 ? (unsigned int) ceil(log((double)size) / log(2.0)) : 0;//log(0) is -inf
 	capacity = 1 << Log;
 	arr = new T[capacity];
 	for (int i = 0; i < size; i++)
@@ -288,7 +288,7 @@ Resizes the Vector object as desired
 template < typename T >
 void Vector<T>::resize(unsigned int size)
 {
-	Log = ceil(log((double)size) / log(2.0));
+	Log = size > 1 ? (unsigned int) ceil(log((double)size) / log(2.0)) : 0;//log(0) is -inf
 	reserve(1 << Log);
 	this->size = size;
 }
@@ -357,4 +357,106 @@ void Vector<T>::clear()
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/*a non-owning view over a contiguous run of T.
+it never allocates or frees anything, so it is only valid
+as long as the storage it was taken from is left alone*/
+template <class T>
+class View
+{
+
+private:
+	T *first;
+	int size;
+
+public:
+
+	View();
+
+	View(T *first, int size);
+
+	T * begin() const;
+
+	T * end() const;
+
+	int getSize() const;
+
+	T & operator[](int index) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+Default constructor, an empty view
+*/
+template < typename T >
+View<T>::View()
+{
+	first = NULL;
+	size = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+View class constructor
+
+@param	first	pointer to the first element of the run
+@param	size	number of elements in the run
+*/
+template < typename T >
+View<T>::View(T *first, int size)
+{
+	this->first = first;
+	this->size = size;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return            pointer to the first element
+*/
+template < typename T >
+T * View<T>::begin() const
+{
+	return first;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return            pointer one past the last element
+*/
+template < typename T >
+T * View<T>::end() const
+{
+	return first + size;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return            the number of elements in the view
+*/
+template < typename T >
+int View<T>::getSize() const
+{
+	return size;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+Square braces operator, no bounds checking
+
+@param	index	the index of the required data
+@return			the reference of the required data
+*/
+template < typename T >
+T & View<T>::operator[](int index) const
+{
+	return first[index];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 #endif
\ No newline at end of file
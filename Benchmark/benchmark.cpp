@@ -0,0 +1,510 @@
+//Benchmark driver for the belief propagation engines.
+/*Builds synthetic polytrees (chains, stars, wide fan-in and random polytrees),
+times graph construction, Graph::initialize(), single and multiple findings with every posterior read, cached queries,
+CPD::p() lookups, the compiled Engine (full and pruned to a few targets) and reading the network back from BIF,
+and prints everything as JSON on stdout. it also checks that the steady state of the Graph takes
+nothing from the heap, every allocation is counted for that, and fails if it does.
+
+usage : Benchmark [--topology all|chain|star|fan-in|random] [--vertices n] [--cardinality c]
+                  [--in-degree d] [--findings k] [--repeats r] [--seed s] [--threads t] [--grain g]*/
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <thread>
+#define BAYES_COUNT_ALLOCATIONS
+#include "generators.h"
+#include "engine.h"
+#include "batch.h"
+#include "bif.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <chrono>
+#endif
+
+using namespace std;
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*the settings of one run, all of them can be changed from the command line*/
+struct Options
+{
+	string topology;
+	int vertices, cardinality, in_degree, findings, repeats, threads, grain;
+	unsigned int seed;
+};
+
+/*mean and percentiles of a set of timings, in microseconds*/
+struct Summary
+{
+	double mean, p50, p99, min;
+};
+
+double now();
+Summary summarize(Vector<double> &samples);
+void printSummary(string name, Summary summary, bool last);
+bool run(Network *network, double construction, Options &options, bool last);
+Options parse(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+	Options options = parse(argc, argv);
+	string names[] = { "chain", "star", "fan-in", "random" };
+	int count = 0;
+	bool passed = true;
+
+	for (int i = 0; i < 4; i++)
+	{
+		count += options.topology == "all" || options.topology == names[i];
+	}
+	if (!count)
+	{
+		cerr << "unknown topology " << options.topology << endl;
+		return 1;
+	}
+
+	cout << "{\n";
+	cout << "\t\"isa\": \"" << Kernel::isa() << "\",\n";
+	cout << "\t\"options\": { \"vertices\": " << options.vertices << ", \"cardinality\": " << options.cardinality
+		<< ", \"in_degree\": " << options.in_degree << ", \"findings\": " << options.findings
+		<< ", \"repeats\": " << options.repeats << ", \"seed\": " << options.seed
+		<< ", \"threads\": " << options.threads << ", \"grain\": " << options.grain << " },\n";
+	cout << "\t\"networks\": [\n";
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (options.topology != "all" && options.topology != names[i])
+			continue;
+
+		double start = now();
+		Network *network = NULL;
+
+		if (names[i] == "chain")
+			network = Network::chain(options.vertices, options.cardinality, options.seed);
+		else if (names[i] == "star")
+			network = Network::star(options.vertices, options.cardinality, options.seed);
+		else if (names[i] == "fan-in")
+			network = Network::fanIn(options.in_degree, options.cardinality, options.seed);
+		else
+			network = Network::random(options.vertices, options.cardinality, options.in_degree, options.seed);
+
+		passed = run(network, now() - start, options, --count == 0) && passed;
+		delete network;
+	}
+
+	cout << "\t]\n}\n";
+	if (!passed)
+	{
+		cerr << "a steady state observe or posterior read allocated on the heap" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		a steady time stamp in microseconds
+*/
+double now()
+{
+#ifdef _WIN32
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return counter.QuadPart * 1e6 / frequency.QuadPart;
+#else
+	return chrono::duration<double, micro>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	samples		the timings, they are sorted in place
+@return				their mean, median, 99th percentile and minimum
+*/
+Summary summarize(Vector<double> &samples)
+{
+	Summary summary = { 0, 0, 0, 0 };
+	int n = samples.getSize();
+	if (!n)
+		return summary;
+
+	sort(samples.begin(), samples.end());
+	for (int i = 0; i < n; i++)
+	{
+		summary.mean += samples[i] / n;
+	}
+	summary.p50 = samples[n / 2];
+	summary.p99 = samples[(n * 99) / 100 < n ? (n * 99) / 100 : n - 1];
+	summary.min = samples[0];
+	return summary;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+prints a summary as a JSON member
+
+@param	name	the name of the member
+@param	summary	the timings
+@param	last	true if no member follows
+*/
+void printSummary(string name, Summary summary, bool last)
+{
+	cout << "\t\t\t\"" << name << "\": { \"mean\": " << summary.mean << ", \"p50\": " << summary.p50
+		<< ", \"p99\": " << summary.p99 << ", \"min\": " << summary.min << " }" << (last ? "\n" : ",\n");
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+times everything on one network and prints it as a JSON object
+
+@param	network			the network
+@param	construction	how long building the network took, in microseconds
+@param	options			the settings of the run
+@param	last			true if no network follows
+@return					false if a finding and reading the posteriors allocated in the steady state
+*/
+bool run(Network *network, double construction, Options &options, bool last)
+{
+	Graph *graph = network->getGraph();
+	Random random(options.seed + 1);
+	int size = network->getSize(), edges = 0;
+	double start;
+
+	for (int i = 0; i < size; i++)
+	{
+		edges += network->getVertex(i)->getParents().getSize();
+	}
+
+	/*Graph::initialize()*/
+	Vector<double> initialize;
+	for (int r = 0; r < options.repeats; r++)
+	{
+		start = now();
+		graph->initialize();
+		initialize.pushBack(now() - start);
+	}
+
+	/*one finding at a time followed by reading every posterior, retracted again outside the timing.
+	observe() only marks what is stale, the messages are computed as the posteriors are read,
+	so both are timed to compare with a propagation which computes everything at once.*/
+	Vector<double> observe;
+	for (int r = 0; r < options.repeats; r++)
+	{
+		Vertex *vertex = network->getVertex(random.next(size));
+		int state = 1 + random.next(options.cardinality);
+
+		start = now();
+		graph->observe(vertex, state);
+		for (int i = 0; i < size; i++)
+		{
+			network->getVertex(i)->update();
+		}
+		observe.pushBack(now() - start);
+
+		graph->retract(vertex);
+	}
+
+	/*one finding followed by reading three posteriors, which computes just the messages they need*/
+	Vector<double> observe_read;
+	for (int r = 0; r < options.repeats; r++)
+	{
+		Vertex *vertex = network->getVertex(random.next(size));
+		Vertex *read[3] = { network->getVertex(random.next(size)), network->getVertex(random.next(size)), network->getVertex(random.next(size)) };
+		int state = 1 + random.next(options.cardinality);
+
+		start = now();
+		graph->observe(vertex, state);
+		for (int i = 0; i < 3; i++)
+		{
+			read[i]->update();
+		}
+		observe_read.pushBack(now() - start);
+
+		graph->retract(vertex);
+	}
+
+	/*the same findings made twice, each followed by reading every posterior. the first round
+	grows the arena of the graph, the second one must not take anything from the heap.*/
+	unsigned long allocations = 0;
+	for (int round = 0; round < 2; round++)
+	{
+		Random steady(options.seed + 2);
+		allocations = Arena::getAllocations();
+		for (int r = 0; r < options.repeats; r++)
+		{
+			Vertex *vertex = network->getVertex(steady.next(size));
+			graph->observe(vertex, 1 + steady.next(options.cardinality));
+			for (int i = 0; i < size; i++)
+			{
+				network->getVertex(i)->update();
+			}
+			graph->retract(vertex);
+		}
+		allocations = Arena::getAllocations() - allocations;
+	}
+
+	/*several findings followed by reading every posterior*/
+	Vector<double> observe_all;
+	Vertex **vertices = new Vertex *[options.findings];
+	int *states = new int[options.findings];
+	for (int r = 0; r < options.repeats; r++)
+	{
+		for (int i = 0; i < options.findings; i++)
+		{
+			vertices[i] = network->getVertex(random.next(size));
+			states[i] = 1 + random.next(options.cardinality);
+		}
+
+		start = now();
+		graph->observeAll(vertices, states, options.findings);
+		for (int i = 0; i < size; i++)
+		{
+			network->getVertex(i)->update();
+		}
+		observe_all.pushBack(now() - start);
+
+		graph->initialize();
+	}
+	delete[] vertices;
+	delete[] states;
+
+	/*queries cycling through a few sets of findings, answered from the posterior cache*/
+	graph->setCache(64);
+	Vector<double> query;
+	Vertex *findings[8][2], *targets[4];
+	int finding_states[8][2];
+	float *posteriors = new float[4 * options.cardinality];
+	for (int s = 0; s < 8; s++)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			findings[s][i] = network->getVertex(random.next(size));
+			finding_states[s][i] = 1 + random.next(options.cardinality);
+		}
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		targets[i] = network->getVertex(random.next(size));
+	}
+	for (int r = 0; r < options.repeats; r++)
+	{
+		start = now();
+		graph->query(findings[r % 8], finding_states[r % 8], 2, targets, 4, posteriors);
+		query.pushBack(now() - start);
+	}
+	double hit_rate = graph->getCache()->getHitRate();
+	graph->setCache(0);
+	graph->initialize();
+	delete[] posteriors;
+
+	/*CPD::p() on the largest table, with random parent combinations*/
+	CPD *table = network->getVertex(network->getLargestTable())->getCPD();
+	int num_of_parents = network->getVertex(network->getLargestTable())->getParents().getSize();
+	int lookups = 1 << 16, width = table->getWidth();
+	Vector<int> combos;
+	for (int i = 0; i < lookups * (num_of_parents + 1); i++)
+	{
+		combos.pushBack(1 + random.next(options.cardinality));
+	}
+
+	volatile float checksum = 0;
+	start = now();
+	for (int i = 0; i < lookups; i++)
+	{
+		int *combo = combos.begin() + i * (num_of_parents + 1);
+		checksum = checksum + table->p(1 + (combo[num_of_parents] - 1) % width, combo);
+	}
+	double lookup_time = now() - start;
+
+	/*the compiled engine*/
+	start = now();
+	Model *model = graph->compile();
+	double compile = now() - start;
+
+	/*the model written to a file and mapped back*/
+	start = now();
+	model->save("benchmark.bn");
+	double save = now() - start;
+
+	start = now();
+	delete Model::load("benchmark.bn");
+	double load = now() - start;
+	remove("benchmark.bn");
+
+	/*the network written as BIF and read back, its tables parsed on the pool*/
+	BifReader::write(graph, "benchmark.bif");
+	double bif_throughput;
+	{
+		BifReader reader("benchmark.bif", options.threads);
+		bif_throughput = reader.getThroughput();
+	}
+	remove("benchmark.bif");
+
+	Engine engine(model);
+	Vector<double> propagate;
+	for (int r = 0; r < options.repeats; r++)
+	{
+		int v = random.next(size);
+		engine.observe(v, 1 + random.next(model->getCardinality(v)));
+
+		start = now();
+		engine.propagate();
+		propagate.pushBack(now() - start);
+
+		engine.initialize();
+	}
+
+	/*one finding and the posteriors of three vertices, sending only the messages they depend on*/
+	Vector<double> pruned;
+	for (int r = 0; r < options.repeats; r++)
+	{
+		int v = random.next(size);
+		int targets[3] = { random.next(size), random.next(size), random.next(size) };
+		engine.observe(v, 1 + random.next(model->getCardinality(v)));
+
+		start = now();
+		engine.query(targets, 3);
+		pruned.pushBack(now() - start);
+
+		engine.initialize();
+	}
+
+	/*the same propagation, with the subtrees spread over a pool*/
+	ThreadPool pool(options.threads);
+	Vector<double> parallel;
+	for (int r = 0; r < options.repeats; r++)
+	{
+		int v = random.next(size);
+		engine.observe(v, 1 + random.next(model->getCardinality(v)));
+
+		start = now();
+		engine.propagate(&pool, options.grain);
+		parallel.pushBack(now() - start);
+
+		engine.initialize();
+	}
+
+	/*the same propagation with the CPTs kept as bfloat16*/
+	BasicModel<BFloat16> *half = graph->compile<BFloat16>();
+	BasicEngine<BFloat16, float> half_engine(half);
+	Vector<double> half_propagate;
+	for (int r = 0; r < options.repeats; r++)
+	{
+		int v = random.next(size);
+		half_engine.observe(v, 1 + random.next(model->getCardinality(v)));
+
+		start = now();
+		half_engine.propagate();
+		half_propagate.pushBack(now() - start);
+
+		half_engine.initialize();
+	}
+	delete half;
+
+	/*64 scenarios with a few findings each, propagated together*/
+	BatchEngine batch(model, 64);
+	for (int s = 0; s < batch.getScenarios(); s++)
+	{
+		for (int i = 0; i < options.findings; i++)
+		{
+			int v = random.next(size);
+			batch.observe(s, v, 1 + random.next(model->getCardinality(v)));
+		}
+	}
+	Vector<double> batch_propagate;
+	for (int r = 0; r < options.repeats; r++)
+	{
+		start = now();
+		batch.propagate();
+		batch_propagate.pushBack(now() - start);
+	}
+	delete model;
+
+	cout << fixed << setprecision(3);
+	cout << "\t\t{\n";
+	cout << "\t\t\t\"topology\": \"" << network->getTopology() << "\",\n";
+	cout << "\t\t\t\"vertices\": " << size << ",\n";
+	cout << "\t\t\t\"edges\": " << edges << ",\n";
+	cout << "\t\t\t\"largest_table\": " << table->getHeight() * table->getWidth() << ",\n";
+	cout << "\t\t\t\"construction_us\": " << construction << ",\n";
+	printSummary("initialize_us", summarize(initialize), false);
+	printSummary("observe_us", summarize(observe), false);
+	printSummary("observe_read_us", summarize(observe_read), false);
+	printSummary("observe_all_us", summarize(observe_all), false);
+	cout << "\t\t\t\"steady_state_allocations\": " << allocations << ",\n";
+	printSummary("cached_query_us", summarize(query), false);
+	cout << "\t\t\t\"cache_hit_rate\": " << hit_rate << ",\n";
+	cout << "\t\t\t\"cpd_p_per_second\": " << (lookup_time > 0 ? lookups * 1e6 / lookup_time : 0) << ",\n";
+	cout << "\t\t\t\"compile_us\": " << compile << ",\n";
+	cout << "\t\t\t\"save_us\": " << save << ",\n";
+	cout << "\t\t\t\"load_us\": " << load << ",\n";
+	cout << "\t\t\t\"bif_parse_mb_per_s\": " << bif_throughput << ",\n";
+	printSummary("engine_propagate_us", summarize(propagate), false);
+	printSummary("pruned_query_us", summarize(pruned), false);
+	printSummary("parallel_propagate_us", summarize(parallel), false);
+	printSummary("bf16_propagate_us", summarize(half_propagate), false);
+	printSummary("batch_propagate_64_us", summarize(batch_propagate), true);
+	cout << "\t\t}" << (last ? "\n" : ",\n");
+	return allocations == 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+reads the options from the command line, anything not given keeps its default
+
+@param	argc	the number of arguments
+@param	argv	the arguments
+@return			the options
+*/
+Options parse(int argc, char *argv[])
+{
+	Options options;
+	options.topology = "all";
+	options.vertices = 256;
+	options.cardinality = 3;
+	options.in_degree = 4;
+	options.findings = 8;
+	options.repeats = 100;
+	options.seed = 2015;
+	options.threads = max((int)thread::hardware_concurrency() - 1, 0);
+	options.grain = 64;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		string option = argv[i];
+		int value = atoi(argv[i + 1]);
+
+		if (option == "--topology")
+			options.topology = argv[i + 1];
+		else if (option == "--vertices")
+			options.vertices = max(value, 1);
+		else if (option == "--cardinality")
+			options.cardinality = max(value, 2);
+		else if (option == "--in-degree")
+			options.in_degree = max(value, 1);
+		else if (option == "--findings")
+			options.findings = max(value, 1);
+		else if (option == "--repeats")
+			options.repeats = max(value, 1);
+		else if (option == "--seed")
+			options.seed = (unsigned int)value;
+		else if (option == "--threads")
+			options.threads = max(value, 0);
+		else if (option == "--grain")
+			options.grain = max(value, 1);
+		else
+			cerr << "ignoring unknown option " << option << endl;
+	}
+
+	return options;
+}
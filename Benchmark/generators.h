@@ -0,0 +1,344 @@
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include "graph.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*a small xorshift generator, so that the same seed gives
+the same networks with every compiler and standard library*/
+class Random
+{
+private:
+
+	unsigned int x;
+
+public:
+
+	Random(unsigned int seed);
+
+	unsigned int next();
+
+	int next(int n);
+
+	float uniform();
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*a synthetic polytree together with the vertices it is made of.
+the Graph does not own its vertices, so the Network deletes them.*/
+class Network
+{
+private:
+
+	string topology;
+
+	Graph *graph;
+
+	Vector<Vertex *> vertices;
+
+	Network(string topology, int size, int cardinality);
+
+	void randomTables(Random &random);
+
+public:
+
+	static Network * chain(int size, int cardinality, unsigned int seed);
+
+	static Network * star(int size, int cardinality, unsigned int seed);
+
+	static Network * fanIn(int in_degree, int cardinality, unsigned int seed);
+
+	static Network * random(int size, int cardinality, int in_degree, unsigned int seed);
+
+	string getTopology();
+
+	Graph * getGraph();
+
+	int getSize();
+
+	Vertex * getVertex(int i);
+
+	int getLargestTable();
+
+	~Network();
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+Random class constructor
+
+@param	seed	any number, 0 is replaced by 1
+*/
+Random::Random(unsigned int seed)
+{
+	x = seed ? seed : 1;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the next 32 random bits
+*/
+unsigned int Random::next()
+{
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	n	the number of possible values
+@return		a number in 0 .. n - 1
+*/
+int Random::next(int n)
+{
+	return (int)(next() % (unsigned int)n);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		a number in [0, 1)
+*/
+float Random::uniform()
+{
+	return (next() >> 8) * (1.0f / 16777216.0f);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+creates the vertices of a network, without any edges
+
+@param	topology	the name of the generator
+@param	size		the number of vertices
+@param	cardinality	the number of states of every vertex
+*/
+Network::Network(string topology, int size, int cardinality)
+{
+	this->topology = topology;
+	graph = new Graph(topology);
+
+	for (int i = 0; i < size; i++)
+	{
+		Vertex *vertex = new Vertex("V" + to_string(i), 0, cardinality);
+		vertices.pushBack(vertex);
+		graph->addVertex(vertex);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+fills every CPT with random rows, normalized to sum to 1, and propagates them
+
+@param	random	the generator to draw from
+*/
+void Network::randomTables(Random &random)
+{
+	for (int i = 0; i < (int)vertices.getSize(); i++)
+	{
+		CPD *table = vertices[i]->getCPD();
+		int size = table->getHeight() * table->getWidth();
+		float *values = CPD::allocate(size);
+
+		for (int j = 0; j < size; j++)
+		{
+			values[j] = 0.05f + random.uniform();
+		}
+		table->adoptTable(values, size, true);
+	}
+
+	graph->initialize();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+V0 -> V1 -> ... -> Vn-1, the longest path for a given size
+
+@param	size		the number of vertices
+@param	cardinality	the number of states of every vertex
+@param	seed		the seed of the random tables
+@return				a new network, to be deleted by the caller
+*/
+Network * Network::chain(int size, int cardinality, unsigned int seed)
+{
+	Random random(seed);
+	Network *network = new Network("chain", size, cardinality);
+
+	for (int i = 1; i < size; i++)
+	{
+		network->graph->connect(network->vertices[i - 1], network->vertices[i]);
+	}
+
+	network->randomTables(random);
+	return network;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+V0 is the parent of every other vertex, the widest fan-out
+
+@param	size		the number of vertices
+@param	cardinality	the number of states of every vertex
+@param	seed		the seed of the random tables
+@return				a new network, to be deleted by the caller
+*/
+Network * Network::star(int size, int cardinality, unsigned int seed)
+{
+	Random random(seed);
+	Network *network = new Network("star", size, cardinality);
+
+	for (int i = 1; i < size; i++)
+	{
+		network->graph->connect(network->vertices[0], network->vertices[i]);
+	}
+
+	network->randomTables(random);
+	return network;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+one vertex with in_degree parents. its CPT has cardinality ^ (in_degree + 1) entries,
+so this is the worst case for the messages of a single vertex.
+
+@param	in_degree	the number of parents
+@param	cardinality	the number of states of every vertex
+@param	seed		the seed of the random tables
+@return				a new network, to be deleted by the caller
+*/
+Network * Network::fanIn(int in_degree, int cardinality, unsigned int seed)
+{
+	Random random(seed);
+	Network *network = new Network("fan-in", in_degree + 1, cardinality);
+
+	for (int i = 0; i < in_degree; i++)
+	{
+		network->graph->connect(network->vertices[i], network->vertices[in_degree]);
+	}
+
+	network->randomTables(random);
+	return network;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+a random polytree : every vertex after the first is joined to one random earlier vertex,
+which keeps the graph singly connected. the edge points into the earlier vertex when
+that one still has fewer than in_degree parents and a coin says so, otherwise out of it.
+
+@param	size		the number of vertices
+@param	cardinality	the number of states of every vertex
+@param	in_degree	the most parents any vertex may get
+@param	seed		the seed of the structure and of the tables
+@return				a new network, to be deleted by the caller
+*/
+Network * Network::random(int size, int cardinality, int in_degree, unsigned int seed)
+{
+	Random random(seed);
+	Network *network = new Network("random", size, cardinality);
+
+	for (int i = 1; i < size; i++)
+	{
+		Vertex *other = network->vertices[random.next(i)], *vertex = network->vertices[i];
+
+		if (other->getParents().getSize() < in_degree && random.next(2))
+			network->graph->connect(vertex, other);
+		else
+			network->graph->connect(other, vertex);
+	}
+
+	network->randomTables(random);
+	return network;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the name of the generator which made the network
+*/
+string Network::getTopology()
+{
+	return topology;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the graph of the network
+*/
+Graph * Network::getGraph()
+{
+	return graph;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the number of vertices
+*/
+int Network::getSize()
+{
+	return vertices.getSize();
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@param	i	a zero-based index
+@return		the i-th vertex, in the order they were created
+*/
+Vertex * Network::getVertex(int i)
+{
+	return vertices[i];
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+/*
+@return		the index of the vertex with the most CPT entries
+*/
+int Network::getLargestTable()
+{
+	int largest = 0;
+
+	for (int i = 1; i < (int)vertices.getSize(); i++)
+	{
+		CPD *a = vertices[i]->getCPD(), *b = vertices[largest]->getCPD();
+		if (a->getHeight() * a->getWidth() > b->getHeight() * b->getWidth())
+			largest = i;
+	}
+	return largest;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------------
+
+Network::~Network()
+{
+	delete graph;
+
+	for (int i = 0; i < (int)vertices.getSize(); i++)
+	{
+		delete vertices[i];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif